@@ -0,0 +1,123 @@
+/*
+  LiteralScanBench.ino, Example for the PageBuilder library.
+  Copyright (c) 2026, Hieromon Ikasamo
+  https://github.com/Hieromon/PageBuilder
+  This software is released under the MIT License.
+  https://opensource.org/licenses/MIT
+
+  This example measures the rendering time of a long token-sparse mold.
+  PageElement::build scans the literal runs of the mold word-at-a-time
+  and emits them in bulk. For the comparison, the sketch also renders
+  the same mold one character at a time through the current lexer,
+  PageElement::_contextRead. It compares the per-character reading with
+  the bulk reading of build, not with the former PageElement, whose
+  lexer differs in the details. The mold is rendered from each storage,
+  PROGMEM, heap and file: mold.
+*/
+
+#if defined(ARDUINO_ARCH_ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <WiFi.h>
+#endif
+#include <PageBuilder.h>
+
+#define ITERATIONS  20
+
+// A paragraph to be repeated in the mold.
+#define PARAGRAPH \
+  "<p class=\"lorem\">Lorem ipsum dolor sit amet, consectetur adipiscing elit, " \
+  "sed do eiusmod tempor incididunt ut labore et dolore magna aliqua.</p>\n"
+#define PARAGRAPHS4 PARAGRAPH PARAGRAPH PARAGRAPH PARAGRAPH
+#define PARAGRAPHS16 PARAGRAPHS4 PARAGRAPHS4 PARAGRAPHS4 PARAGRAPHS4
+
+static const char LONG_MOLD[] PROGMEM =
+  "<html><head><title>{{TITLE}}</title></head><body>\n"
+  PARAGRAPHS16 PARAGRAPHS16
+  "<p>Uptime: {{UPTIME}}</p></body></html>";
+
+// The PageElement that can build the content one character at a time
+// with the current lexer, without the bulk reading of the literal runs.
+class CharwiseElement : public PageElement {
+ public:
+  using PageElement::PageElement;
+  size_t  buildCharwise(String& buffer, PageArgument& args) {
+    buffer.clear();
+    buffer.reserve(getApproxSize() + 32);
+    rewind();
+    char  c;
+    while ((c = _contextRead(args)))
+      buffer.concat(c);
+    return buffer.length();
+  }
+};
+
+String title(PageArgument& args) {
+  (void)(args);
+  return String(F("Benchmark"));
+}
+
+String uptime(PageArgument& args) {
+  (void)(args);
+  return String(millis());
+}
+
+CharwiseElement elm(FPSTR(LONG_MOLD), {
+  { "TITLE", title },
+  { "UPTIME", uptime }
+});
+
+void measure(const char* storage) {
+  PageArgument  args;
+  String  content;
+  unsigned long tm;
+  size_t  len = 0;
+
+  tm = micros();
+  for (int i = 0; i < ITERATIONS; i++)
+    len = elm.buildCharwise(content, args);
+  unsigned long charwise = (micros() - tm) / ITERATIONS;
+
+  tm = micros();
+  for (int i = 0; i < ITERATIONS; i++)
+    len = elm.build(content, args);
+  unsigned long bulk = (micros() - tm) / ITERATIONS;
+
+  Serial.printf("%-8s %6u bytes, charwise %7lu us, bulk %7lu us\n", storage, len, charwise, bulk);
+}
+
+void setup() {
+  delay(1000);
+  Serial.begin(115200);
+  Serial.println();
+  WiFi.mode(WIFI_OFF);
+
+  // The mold in PROGMEM
+  measure("PROGMEM");
+
+  // The mold in the heap
+  char* heapMold = reinterpret_cast<char*>(malloc(sizeof(LONG_MOLD)));
+  if (heapMold) {
+    strcpy_P(heapMold, LONG_MOLD);
+    elm.setMold(heapMold);
+    measure("heap");
+  }
+
+  // The mold in the file
+  if (PB_APPLIED_FILESYSTEM.begin()) {
+    File  mf = PB_APPLIED_FILESYSTEM.open("/bench.htm", "w");
+    if (mf) {
+      mf.print(FPSTR(LONG_MOLD));
+      mf.close();
+      elm.setMold("file:/bench.htm");
+      measure("file");
+      PB_APPLIED_FILESYSTEM.remove("/bench.htm");
+    }
+  }
+
+  elm.setMold(FPSTR(LONG_MOLD));
+  if (heapMold)
+    free(heapMold);
+}
+
+void loop() {}
@@ -0,0 +1,56 @@
+/*
+  MemoryFootprint.ino, Example for the PageBuilder library.
+  Copyright (c) 2026, Hieromon Ikasamo
+  https://github.com/Hieromon/PageBuilder
+  This software is released under the MIT License.
+  https://opensource.org/licenses/MIT
+
+  This example reports the memory footprint of the PageBuilder classes
+  on the target it runs on. It prints the size of each class, and the
+  heap that a PageElement with two tokens consumes at its construction
+  besides its own size. Build it with and without PB_TOKEN_FUNCPTR to
+  compare the token handler of the function pointer with std::function.
+*/
+
+#if defined(ARDUINO_ARCH_ESP8266)
+#include <ESP8266WiFi.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <WiFi.h>
+#endif
+#include <PageBuilder.h>
+
+String hello(PageArgument& args) {
+  (void)(args);
+  return String(F("Hello"));
+}
+
+void report(const char* name, const size_t size) {
+  Serial.printf("%-13s %4u bytes\n", name, size);
+}
+
+void setup() {
+  delay(1000);
+  Serial.begin(115200);
+  Serial.println();
+  WiFi.mode(WIFI_OFF);
+
+  report("String", sizeof(String));
+  report("HandleFuncT", sizeof(HandleFuncT));
+  report("TokenSource", sizeof(TokenSource));
+  report("PageArgument", sizeof(PageArgument));
+  report("PageElement", sizeof(PageElement));
+  report("PageBuilder", sizeof(PageBuilder));
+
+  // The heap consumed by the element apart from its own size, which
+  // includes the token container.
+  const size_t  freeHeap = ESP.getFreeHeap();
+  PageElement*  elm = new PageElement("<p>{{A}} {{B}}</p>", {
+    { "A", hello },
+    { "B", hello }
+  });
+  const size_t  consumed = freeHeap - ESP.getFreeHeap();
+  Serial.printf("PageElement with 2 tokens, heap %u bytes besides %u\n", consumed - sizeof(PageElement), sizeof(PageElement));
+  delete elm;
+}
+
+void loop() {}
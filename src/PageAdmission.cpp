@@ -0,0 +1,99 @@
+/**
+ *  An implementation of the admission control of the page rendering.
+ *  @file PageAdmission.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageAdmission.h"
+
+/**
+ * Construct the controller with the limits.
+ * @param   renders   Limit of the concurrent renderings.
+ * @param   reserved  Limit of the heap reserved by the renderings.
+ * @param   minHeap   Free heap to be left after the reservation.
+ */
+PageAdmission::PageAdmission(const unsigned int renders, const size_t reserved, const size_t minHeap) {
+  setLimits(renders, reserved, minHeap);
+  setRetryAfter(PAGEADMISSION_RETRY_AFTER);
+}
+
+/**
+ * The global controller that applies to all pages.
+ * @return  Reference of the global controller.
+ */
+PageAdmission& PageAdmission::global(void) {
+  static PageAdmission  admission;
+  return admission;
+}
+
+/**
+ * Set the limits. The limit of zero is not applied.
+ * @param   renders   Limit of the concurrent renderings.
+ * @param   reserved  Limit of the heap reserved by the renderings.
+ * @param   minHeap   Free heap to be left after the reservation.
+ */
+void PageAdmission::setLimits(const unsigned int renders, const size_t reserved, const size_t minHeap) {
+  _maxRenders = renders;
+  _maxReserved = reserved;
+  _minHeap = minHeap;
+}
+
+/**
+ * Set the seconds of the Retry-After header of the shed response.
+ * @param   seconds   Seconds to wait for the retry.
+ */
+void PageAdmission::setRetryAfter(const unsigned int seconds) {
+  _retryAfter = String(seconds);
+}
+
+/**
+ * Reserve the rendering with the heap demand. The reservation is made
+ * first and reverted if it exceeds the limits, so the concurrent
+ * renderings never exceed them together.
+ * @param   demand  Heap predicted to be consumed by the rendering.
+ * @return  false   The request should be shed.
+ */
+bool PageAdmission::_admit(const size_t demand) {
+  const unsigned int  renders = ++_renders;
+  const size_t  reserved = _reserved += demand;
+
+  if ((_maxRenders && renders > _maxRenders) || (_maxReserved && reserved > _maxReserved) || (_minHeap && ESP.getFreeHeap() < demand + _minHeap)) {
+    PB_DBG("Shed renders:%u, reserved:%u, free:%u\n", renders, reserved, ESP.getFreeHeap());
+    _release(demand);
+    _shed++;
+    return false;
+  }
+  _admitted++;
+  return true;
+}
+
+/**
+ * Respond to the shed request with 503 and the precomposed Retry-After.
+ * @param   server  Reference of the WebServer instance.
+ */
+void PageAdmission::_reject(WebServer& server) const {
+  server.sendHeader(F("Retry-After"), _retryAfter);
+  server.send_P(503, PSTR("text/plain"), PSTR("Service Unavailable"));
+}
+
+/**
+ * Release the reservation of the rendering.
+ * @param   demand  Heap reserved at the admission.
+ */
+void PageAdmission::_release(const size_t demand) {
+  _renders--;
+  _reserved -= demand;
+}
+
+/**
+ * Revert the admission of the request that another controller has shed.
+ * The request is not counted as admitted.
+ * @param   demand  Heap reserved at the admission.
+ */
+void PageAdmission::_revoke(const size_t demand) {
+  _release(demand);
+  _admitted--;
+}
@@ -0,0 +1,73 @@
+/**
+ *  Declaration of PageAdmission class.
+ *  @file PageAdmission.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEADMISSION_H_
+#define _PAGEADMISSION_H_
+
+#include <atomic>
+#include "PageBuilder.h"
+
+// Seconds of the Retry-After header that the shed request is responded
+// with.
+#ifndef PAGEADMISSION_RETRY_AFTER
+#define PAGEADMISSION_RETRY_AFTER         3
+#endif
+
+/**
+ * Admission control of the page rendering. The controller limits the
+ * number of the concurrent renderings, the total heap reserved by them
+ * and the free heap that must remain after the reservation. The request
+ * that would exceed the limits is shed with 503 Service Unavailable and
+ * the Retry-After header before anything is built. The global controller
+ * applies to all pages, and a controller set to the pages with
+ * PageBuilder::setAdmission applies to them in addition. The limit of
+ * zero is not applied.
+ */
+class PageAdmission {
+  friend class PageBuilder;
+
+ public:
+  explicit PageAdmission(const unsigned int renders = 0, const size_t reserved = 0, const size_t minHeap = 0);
+  ~PageAdmission() {}
+  PageAdmission(const PageAdmission&) = delete;
+  PageAdmission& operator=(const PageAdmission&) = delete;
+  unsigned long admitted(void) const { return _admitted; }
+  static PageAdmission& global(void);
+  unsigned int  renders(void) const { return _renders; }
+  size_t  reserved(void) const { return _reserved; }
+  void  setLimits(const unsigned int renders, const size_t reserved = 0, const size_t minHeap = 0);
+  void  setRetryAfter(const unsigned int seconds);
+  unsigned long shed(void) const { return _shed; }
+
+ protected:
+#if defined(ARDUINO_ARCH_ESP8266)
+  // The WebServer of ESP8266 handles the requests only in the loop.
+  template<typename T>
+  using _CounterT = T;
+#else
+  template<typename T>
+  using _CounterT = std::atomic<T>;
+#endif
+
+  bool  _admit(const size_t demand);  /**< Reserve the rendering */
+  void  _reject(WebServer& server) const; /**< Respond with 503 */
+  void  _release(const size_t demand);  /**< Release the reservation */
+  void  _revoke(const size_t demand);   /**< Revert the admission */
+
+  unsigned int  _maxRenders;          /**< Limit of the concurrent renderings */
+  size_t  _maxReserved;               /**< Limit of the reserved heap */
+  size_t  _minHeap;                   /**< Free heap to be left */
+  String  _retryAfter;                /**< Precomposed Retry-After value */
+  _CounterT<unsigned int> _renders{0};    /**< Current renderings */
+  _CounterT<size_t> _reserved{0};     /**< Heap reserved by the current renderings */
+  _CounterT<unsigned long>  _admitted{0}; /**< Number of the admitted requests */
+  _CounterT<unsigned long>  _shed{0}; /**< Number of the shed requests */
+};
+
+#endif // !_PAGEADMISSION_H_
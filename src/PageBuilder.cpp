@@ -8,12 +8,29 @@
  *  @copyright  MIT license.
  */
 
+#include <algorithm>
 #include <Arduino.h>
 #include "PageBuilder.h"
+#include "PageAdmission.h"
 #include "PageStream.h"
+#include "PageMinify.h"
+#include "PageOutput.h"
+#include "PagePrefetch.h"
+#include "PageSession.h"
+#include "PageScan.h"
+#include "PageTrace.h"
+#if defined(PB_MOLD_MAPPED)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <esp_idf_version.h>
+#include <esp_partition.h>
+#endif
 
 // Determining the valid file system currently configured
-namespace PageBuilderFS { PB_APPLIED_FILECLASS& flash = PB_APPLIED_FILESYSTEM; };
+namespace PageBuilderFS { PB_APPLIED_FILECLASS& flash = PB_APPLIED_FILESYSTEM; }
 
 // Allocate static null string
 const String PageArgument::_nullString = String();
@@ -25,6 +42,124 @@ const PageBuilder::_httpHeaderConstST  PageBuilder::_headersNocache[] PROGMEM =
   { "Expires", "-1" }
 };
 
+// Request headers that PageBuilder refers to, they need to be collected
+// by the WebServer.
+const char* const PageBuilder::_requestHeaders[] = {
+  "Range",
+  "If-Range",
+  "Cookie",
+  "Accept-Encoding"
+};
+
+namespace {
+  // The gzip is acceptable unless its quality value is zero. The
+  // wildcard applies if the gzip is not listed.
+  bool _acceptsGzip(const String& accept) {
+    int gzip = -1;
+    int any = -1;
+    int from = 0;
+    while (from < static_cast<int>(accept.length())) {
+      int to = accept.indexOf(',', from);
+      if (to < 0)
+        to = accept.length();
+      String  coding = accept.substring(from, to);
+      from = to + 1;
+      const int param = coding.indexOf(';');
+      int quality = 1;
+      if (param >= 0) {
+        const int q = coding.indexOf(F("q="), param);
+        if (q >= 0)
+          quality = coding.substring(q + 2).toFloat() > 0;
+        coding = coding.substring(0, param);
+      }
+      coding.trim();
+      if (coding.equalsIgnoreCase(F("gzip")))
+        gzip = quality;
+      else if (coding == "*")
+        any = quality;
+    }
+    return gzip >= 0 ? gzip : any > 0;
+  }
+
+  // Content-Type of the static file by its extension.
+  const char* _contentType(const char* path) {
+    static const struct {
+      const char* extension;
+      const char* mime;
+    } types[] = {
+      { ".htm", "text/html" }, { ".html", "text/html" }, { ".css", "text/css" },
+      { ".js", "application/javascript" }, { ".json", "application/json" },
+      { ".txt", "text/plain" }, { ".log", "text/plain" }, { ".csv", "text/csv" },
+      { ".xml", "text/xml" }, { ".svg", "image/svg+xml" }, { ".png", "image/png" },
+      { ".jpg", "image/jpeg" }, { ".gif", "image/gif" }, { ".ico", "image/x-icon" },
+      { ".pdf", "application/pdf" }
+    };
+    const char* extension = strrchr(path, '.');
+    if (extension && !strchr(extension, '/')) {
+      for (const auto& type : types)
+        if (!strcasecmp(extension, type.extension))
+          return type.mime;
+    }
+    return "application/octet-stream";
+  }
+
+  // The file: mold to be minified is the HTML.
+  bool _isHtml(const char* path) {
+    const char* extension = strrchr(path, '.');
+    return extension && (!strcasecmp(extension, ".htm") || !strcasecmp(extension, ".html"));
+  }
+
+  bool _isDigits(const String& str) {
+    if (!str.length())
+      return false;
+    for (unsigned int i = 0; i < str.length(); i++)
+      if (!isDigit(str[i]))
+        return false;
+    return true;
+  }
+
+  /**
+   * Parse the byte range of the Range request header. Multiple ranges
+   * are not supported, and the whole content answers them.
+   * @param   range   The value of the Range header.
+   * @param   size    Size of the content.
+   * @param   first   Offset of the first byte of the range.
+   * @param   last    Offset of the last byte of the range.
+   * @return  1 if the range is valid, 0 if the range is ignored, -1 if
+   * the range is not satisfiable.
+   */
+  int _parseRange(const String& range, const size_t size, size_t& first, size_t& last) {
+    if (!range.startsWith(F("bytes=")) || range.indexOf(',') >= 0)
+      return 0;
+    const int dash = range.indexOf('-');
+    if (dash < 0)
+      return 0;
+    String  fs = range.substring(6, dash);
+    String  ls = range.substring(dash + 1);
+    fs.trim();
+    ls.trim();
+
+    if (!fs.length()) {
+      // The suffix range that specifies the length of the tail.
+      if (!_isDigits(ls))
+        return 0;
+      const size_t  suffix = strtoul(ls.c_str(), nullptr, 10);
+      if (!suffix || !size)
+        return -1;
+      first = suffix < size ? size - suffix : 0;
+      last = size - 1;
+      return 1;
+    }
+    if (!_isDigits(fs) || (ls.length() && !_isDigits(ls)))
+      return 0;
+    first = strtoul(fs.c_str(), nullptr, 10);
+    if (first >= size)
+      return -1;
+    last = ls.length() ? std::min(static_cast<size_t>(strtoul(ls.c_str(), nullptr, 10)), size - 1) : size - 1;
+    return last < first ? 0 : 1;
+  }
+}
+
 /**
  * get request argument value, specifies an i as index to get POST body.
  * @param   i Index of the arguments
@@ -87,19 +222,183 @@ const PageArgument::_RequestArgumentST& PageArgument::_item(int i) const {
  * Add a PageElement token, with registering the correspondence handler.
  * It is an interface for tokens placed in the heap.
  * @param   token   const char*
+ * @param   handler Token handler
+ * @param   escape  Escape mode applied to the replacement string
  */
-void PageElement::addToken(const char* token, HandleFuncT handler) {
-  TokenSource source(token, handler);
-  _sources.push_back(source);
+void PageElement::addToken(const char* token, HandleFuncT handler, PageEscape::Escape_t escape) {
+  _setToken(TokenSource(token, handler, escape), token);
 }
 
 /**
  * Add a PageElement token, with registering the correspondence handler.
  * It is an interface for tokens placed in the .irom.text segment.
  * @param   token   const __FlashStringHelper*
+ * @param   handler Token handler
+ * @param   escape  Escape mode applied to the replacement string
+ */
+void PageElement::addToken(const __FlashStringHelper* token, HandleFuncT handler, PageEscape::Escape_t escape) {
+  _setToken(TokenSource(token, handler, escape), String(token).c_str());
+}
+
+/**
+ * Set the deadline of the token handler. The handler is still called
+ * synchronously, and if it reports that the value is not ready with
+ * PageArgument::notReady, or the render budget of the page has run out
+ * before calling it, the token is replaced by the last value of the
+ * handler, or the fallback until the value is cached. The handler that
+ * runs past the timeout is counted and suspended for a while.
+ * @param   token     The token to be timed.
+ * @param   timeout   Deadline of the handler in milliseconds.
+ * @param   fallback  Replacement until the handler returns the value.
+ */
+void PageElement::setTimeout(const char* token, const unsigned long timeout, const char* fallback) {
+  for (_DeadlineST& deadline : _deadlines) {
+    if (deadline.token == token) {
+      deadline.timeout = timeout;
+      deadline.fallback = fallback ? String(fallback) : String();
+      return;
+    }
+  }
+  _deadlines.push_front({ String(token), fallback ? String(fallback) : String(), String(), timeout, 0, 0, false, false });
+}
+
+/**
+ * Mark the token whose handler does not depend on the other handlers,
+ * and can be evaluated in parallel with the rendering of the page.
+ * @param   token       The token to be marked.
+ * @param   independent The handler is independent.
+ */
+void PageElement::setIndependent(const char* token, const bool independent) {
+  for (TokenSource& source : _sources)
+    if (source.match(token))
+      source.independent = independent;
+}
+
+/**
+ * Returns the number of the timeouts of the token handler.
+ * @param   token   The token, or nullptr for the total of the element.
+ * @return  Number of the timeouts.
+ */
+unsigned int PageElement::timeouts(const char* token) const {
+  unsigned int  count = 0;
+
+  for (const _DeadlineST& deadline : _deadlines)
+    if (!token || deadline.token == token)
+      count += deadline.timeouts;
+  return count;
+}
+
+/**
+ * Call the token handler. The result is taken from the pre-evaluation
+ * if the handler has been dispatched for the current rendering.
+ * @param   source  The token source
+ * @param   args    Arguments to be passed to the token handler.
+ * @param   timeout Milliseconds to wait for the pre-evaluation. The
+ * value is not ready if it has not completed in time.
+ * @return  The replacement string.
+ */
+String PageElement::_call(const TokenSource& source, PageArgument& args, const unsigned long timeout) {
+  String  value;
+
+  if (args._prefetch && args._prefetch->take(source, value, args._ready, timeout))
+    return value;
+  PB_TRACE_SPAN("token", source.name());
+  return source.builder(args);
+}
+
+/**
+ * Evaluate the token. The values memoized by the measuring pass are
+ * replayed in the same order as they were evaluated, so the content has
+ * the measured length.
+ * @param   source  The token source
+ * @param   args    Arguments to be passed to the token handler.
+ * @return  The replacement string.
+ */
+String PageElement::_evaluate(const TokenSource& source, PageArgument& args) {
+  if (!args._memo)
+    return _invoke(source, args);
+  if (!args._record && args._replay < args._memo->size())
+    return std::move((*args._memo)[args._replay++]);
+  String  value = _invoke(source, args);
+  if (args._record)
+    args._memo->push_back(value);
+  return value;
+}
+
+/**
+ * Call the token handler within its deadline. The token without the
+ * deadline is called as it is.
+ * @param   source  The token source
+ * @param   args    Arguments to be passed to the token handler.
+ * @return  The replacement string.
+ */
+String PageElement::_invoke(const TokenSource& source, PageArgument& args) {
+  _DeadlineST*  deadline = nullptr;
+
+  for (_DeadlineST& timed : _deadlines) {
+    if (source.match(timed.token.c_str())) {
+      deadline = &timed;
+      break;
+    }
+  }
+  if (!deadline)
+    return _call(source, args);
+
+  const unsigned long start = millis();
+  if (deadline->backoff && start - deadline->overrun >= PAGEELEMENT_TOKEN_BACKOFF)
+    deadline->backoff = false;
+  if (args._budget && start - args._start >= args._budget) {
+    PB_DBG("Render budget exhausted at %s\n", deadline->token.c_str());
+    deadline->timeouts++;
+  }
+  else if (!deadline->backoff) {
+    // The pre-evaluation is waited for within the deadline and the
+    // remaining budget.
+    unsigned long timeout = deadline->timeout;
+    if (args._budget)
+      timeout = std::min(timeout, args._budget - (start - args._start));
+    args._ready = true;
+    String  value = _call(source, args, timeout);
+    // The handler that is not ready, however quickly it answers, is
+    // counted and backed off as well as the overrun.
+    if (!args._ready) {
+      PB_DBG("Token %s not ready, %lums\n", deadline->token.c_str(), millis() - start);
+      deadline->timeouts++;
+      deadline->overrun = millis();
+      deadline->backoff = true;
+    }
+    if (args._ready) {
+      // The value returned late is still valid, but the handler will
+      // not be called for a while.
+      const unsigned long now = millis();
+      if (now - start > deadline->timeout) {
+        PB_DBG("Token %s timed out, %lums\n", deadline->token.c_str(), now - start);
+        deadline->timeouts++;
+        deadline->overrun = now;
+        deadline->backoff = true;
+      }
+      deadline->cached = value;
+      deadline->valid = true;
+      return value;
+    }
+  }
+  return deadline->valid ? deadline->cached : deadline->fallback;
+}
+
+/**
+ * Register the token source. If the same token has already been
+ * registered, its handler is replaced so that re-registering the tokens
+ * for each request does not accumulate the sources.
+ * @param   source  The token source
+ * @param   key     The token placed in the heap for the comparison
  */
-void PageElement::addToken(const __FlashStringHelper* token, HandleFuncT handler) {
-  TokenSource source(token, handler);
+void PageElement::_setToken(const TokenSource& source, const char* key) {
+  for (TokenSource& registered : _sources) {
+    if (registered.match(key)) {
+      registered = source;
+      return;
+    }
+  }
   _sources.push_back(source);
 }
 
@@ -122,6 +421,7 @@ size_t PageElement::build(String& buffer) {
  * @return  Size of an actual HTML content.
  */
 size_t PageElement::build(String& buffer, PageArgument& args) {
+  PB_TRACE_SPAN("build", nullptr);
   char    c;
   size_t  wc = 0;
   size_t  rSize = _reserveSize;
@@ -135,15 +435,45 @@ size_t PageElement::build(String& buffer, PageArgument& args) {
   }
 
   rewind();                 // Reset the scanning position.
-  c = _contextRead(args);   // Content construction loop
-  while (c) {               // Stops at nul character
+  while (true) {            // Content construction loop
+    // The literal runs are concatenated at once, and the lexer with
+    // each character takes over at the token delimiter.
+    // The scanning position advances only for the concatenated content,
+    // so that the building that failed due to the heap shortage can be
+    // resumed by the streaming build from where it stopped.
+    PGM_P   run;
+    char    block[64];
+    size_t  len;
+    if (_raw._storage == TokenSource::STORAGE_CLASS_t::TEXT) {
+      // The run in the PROGMEM is copied through a local block.
+      if ((len = _literal(run, sizeof(block)))) {
+        memcpy_P(block, run, len);
+        run = block;
+      }
+    }
+    else
+      len = _literal(run);
+    if (len) {
+      if (!buffer.concat(run, len)) {
+        PB_DBG("Element building failure\n");
+        break;
+      }
+      _literalSkip(len);
+      wc += len;
+      continue;
+    }
+
+    c = _contextRead(args);
+    if (!c)                 // Stops at nul character
+      break;
     if (buffer.concat(c))
       wc++;
     else {
+      // Pushes back the character that could not be stored.
+      _back_c = c;
       PB_DBG("Element building failure\n");
       break;
     }
-    c = _contextRead(args);
   }
   return wc;
 }
@@ -156,9 +486,15 @@ size_t PageElement::build(String& buffer, PageArgument& args) {
  * @return  Size of constructed content
  */
 size_t PageElement::build(char* buffer, size_t length, PageArgument& args) {
+  PB_TRACE_SPAN("build", nullptr);
   size_t  wc = 0;
 
   while (wc < length) {
+    const size_t  len = _literalRead(buffer + wc, length - wc);
+    if (len) {
+      wc += len;
+      continue;
+    }
     char  c = _contextRead(args);
     if (!c)
       break;
@@ -167,6 +503,32 @@ size_t PageElement::build(char* buffer, size_t length, PageArgument& args) {
   return wc;
 }
 
+/**
+ * Measure the length of the content without storing it. The literal
+ * runs are counted in bulk.
+ * @param   args    Arguments to be passed to the token handler.
+ * @return  Length of the content.
+ */
+size_t PageElement::_measure(PageArgument& args) {
+  size_t  wc = 0;
+
+  rewind();
+  while (true) {
+    PGM_P   run;
+    const size_t  len = _literal(run);
+    if (len) {
+      _literalSkip(len);
+      wc += len;
+      continue;
+    }
+    if (!_contextRead(args))
+      break;
+    wc++;
+  }
+  rewind();
+  return wc;
+}
+
 /**
  * Read as context while replacing the token contained in the mold with
  * the actual string
@@ -179,7 +541,12 @@ char PageElement::_contextRead(PageArgument& args) {
   // Reading is invalid if the mold is read to the end and the
   // element has reached the end.
   if (!_eoe) {
-    if (_sub_c) {
+    if (_back_c) {
+      // The pushed back character precedes the lexer.
+      c = _back_c;
+      _back_c = '\0';
+    }
+    else if (_sub_c) {
       // If the token separation is not established after reading the
       // first delimiter, the character is valid as content.
       c = _sub_c;
@@ -188,6 +555,7 @@ char PageElement::_contextRead(PageArgument& args) {
     else {
       bool  subseq = false;
       do {
+        subseq = false;
         c = _read();
         if (c == PAGEBUILDER_TOKENDELIMITER_OPEN) {
           _sub_c = _read();
@@ -197,21 +565,40 @@ char PageElement::_contextRead(PageArgument& args) {
             String  token = _extractToken();
             if (token.length()) {
               // here, matches a token
-              HandleFuncT exchanger = nullptr;
+              TokenSource*  exchanger = nullptr;
               for (TokenSource& source : _sources) {
                 // Find the token replacement source
                 if (source.match(token.c_str())) {
-                  exchanger = source.builder;
+                  exchanger = &source;
                   break;
                 }
               }
-              if (exchanger) {
+              if (exchanger && exchanger->builder && _depth >= PAGEELEMENT_INDEXSTACK_DEPTH) {
+                PB_DBG("Token %s nesting exceeds %u\n", token.c_str(), PAGEELEMENT_INDEXSTACK_DEPTH);
+              }
+              else if (exchanger && exchanger->builder) {
                 // Get token replacement string, extract into the content
-                _indexStack.push(_raw);
-                _raw._fillin = exchanger(args);
-                _raw._storage = TokenSource::STORAGE_CLASS_t::STRING;
+                // with escaping according to the token.
+                _indexStack[_depth++] = std::move(_raw);
+                // The typed handler formats its value into the arguments,
+                // and it is read in place without the String. The value
+                // that is timed or memoized goes through the String.
+                const bool  inPlace = _deadlines.empty() && !args._memo;
+                args._format = inPlace;
+                _raw._fillin = _evaluate(*exchanger, args);
                 _raw._s = 0;
-                _raw._p = nullptr;
+                if (inPlace && !args._format) {
+                  _raw._storage = TokenSource::STORAGE_CLASS_t::HEAP;
+                  _raw._p = args._value;
+                }
+                else {
+                  args._format = false;
+                  if (!PageEscape::escape(_raw._fillin, exchanger->escape)) {
+                    PB_DBG("Token escaping failed, free:%u\n", ESP.getFreeHeap());
+                  }
+                  _raw._storage = TokenSource::STORAGE_CLASS_t::STRING;
+                  _raw._p = nullptr;
+                }
                 // Read context again due to source changes
                 c = _contextRead(args);
               }
@@ -260,61 +647,599 @@ String PageElement::_extractToken(void) {
 char PageElement::_read(void) {
   int c = 0x0;
 
-  if (_raw._storage == TokenSource::STORAGE_CLASS_t::HEAP)
-    c = *_raw._p++;
-  else if (_raw._storage == TokenSource::STORAGE_CLASS_t::TEXT)
-    c = static_cast<char>(pgm_read_byte(_raw._p++));
+  // The position stays on the terminator so that the lexer that reads
+  // ahead at the end of the mold does not run out of it.
+  if (_raw._storage == TokenSource::STORAGE_CLASS_t::HEAP) {
+    if ((c = *_raw._p))
+      _raw._p++;
+  }
+  else if (_raw._storage == TokenSource::STORAGE_CLASS_t::TEXT) {
+    if ((c = static_cast<char>(pgm_read_byte(_raw._p))))
+      _raw._p++;
+  }
   else if (_raw._storage == TokenSource::STORAGE_CLASS_t::STRING) {
     if (_raw._s < _raw._fillin.length())
       c = _raw._fillin[_raw._s++];
     else
       // Forcibly release the fill string that has been read.
-      _raw._fillin.~String();
+      _raw._fillin = String();
   }
   else if (_raw._storage == TokenSource::STORAGE_CLASS_t::FILE) {
-    if (!_raw._file) {
-      PB_DBG_DUMB("\n");
-      File  mf = PageBuilderFS::flash.open(_mold, "r");
-      if (mf) {
-        PB_DBG("_mold %s opened, ", mf.name());
-        _raw._file = std::make_shared<File>(mf);
-      }
-      else {
-        PB_DBG("_mold %s open failed", _mold);
+    // The position of the file: mold indicates whether the file has
+    // been read to the end, and it stays there until rewinding.
+    if (!_file) {
+      if (!_raw._p || !_openFile())
         return '\0';
-      }
     }
-    if ((c = _raw._file->read()) == -1) {
-      _raw._file->close();
-      _raw._file.reset();
+    if (_fillFile())
+      c = _file->data[_file->pos++];
+    else {
+      _file->file.close();
+      _file.reset();
+      _raw._p = nullptr;
       c = '\0';
     }
   }
 
   // Just the eos will not indicate the finished reading.
   if (!c) {
-    if (!_indexStack.empty()) {
+    if (_depth) {
       // Recovers the last reading address the mold during reading.
       // And returns to the previous reading process.
-      _raw = _indexStack.top();
-      _indexStack.pop();
+      _raw = std::move(_indexStack[--_depth]);
       c = _read();
     }
   }
   return static_cast<char>(c);
 }
 
+/**
+ * Find the literal run that continues from the current scanning position
+ * up to the token delimiter or the end of the current source. The run
+ * is found with the word-at-a-time scanning and is not consumed.
+ * @param   run   Returns the head of the run. If the current source is
+ * TEXT, the run is in the PROGMEM.
+ * @param   limit Upper limit of the run length to scan.
+ * @return  Length of the run. Zero means that the next character must
+ * be read by the lexer.
+ */
+size_t PageElement::_literal(PGM_P& run, const size_t limit) {
+  size_t  len = 0;
+
+  if (_eoe || _sub_c || _back_c)
+    return 0;
+
+  switch (_raw._storage) {
+  case TokenSource::STORAGE_CLASS_t::HEAP:
+  case TokenSource::STORAGE_CLASS_t::TEXT:
+    run = _raw._p;
+    len = PageBuilderUtil::scanDelimiter(run, PAGEBUILDER_TOKENDELIMITER_OPEN, _raw._storage == TokenSource::STORAGE_CLASS_t::TEXT, limit);
+    break;
+  case TokenSource::STORAGE_CLASS_t::STRING:
+    if (_raw._s < _raw._fillin.length()) {
+      run = _raw._fillin.c_str() + _raw._s;
+      len = PageBuilderUtil::scanDelimiter(run, std::min(static_cast<size_t>(_raw._fillin.length() - _raw._s), limit), PAGEBUILDER_TOKENDELIMITER_OPEN);
+    }
+    break;
+  case TokenSource::STORAGE_CLASS_t::FILE:
+    if (_file && _fillFile()) {
+      run = _file->data + _file->pos;
+      len = std::min(_file->len - _file->pos, limit);
+      // The literal segment of the precompiled mold contains no token.
+      if (!_file->compiled || !_file->compiled->literal)
+        len = PageBuilderUtil::scanDelimiter(run, len, PAGEBUILDER_TOKENDELIMITER_OPEN);
+    }
+    break;
+  }
+  return len;
+}
+
+/**
+ * Read the literal run in bulk up to the token delimiter.
+ * @param   buffer  Output buffer
+ * @param   length  Buffer capacity
+ * @return  Length of the read run.
+ */
+size_t PageElement::_literalRead(char* buffer, size_t length) {
+  PGM_P run;
+  const size_t  len = _literal(run, length);
+
+  if (len) {
+    if (_raw._storage == TokenSource::STORAGE_CLASS_t::TEXT)
+      memcpy_P(buffer, run, len);
+    else
+      memcpy(buffer, run, len);
+    _literalSkip(len);
+  }
+  return len;
+}
+
+/**
+ * Advance the scanning position over the literal run.
+ * @param   len   Length of the run that was consumed.
+ */
+void PageElement::_literalSkip(size_t len) {
+  if (_raw._storage == TokenSource::STORAGE_CLASS_t::STRING)
+    _raw._s += len;
+  else if (_raw._storage == TokenSource::STORAGE_CLASS_t::FILE)
+    _file->pos += len;
+  else
+    _raw._p += len;
+}
+
+/**
+ * Read the literal prefix of the element that precedes the first token
+ * without evaluating the tokens. The delimiter that does not open a
+ * token is a part of the prefix. The scanning stops in front of the
+ * token, or at the end of the element that marks it as read. The token
+ * across the block boundary of the file: mold also stops the scanning.
+ * @param   buffer  Output buffer
+ * @param   length  Buffer capacity
+ * @return  Length of the read prefix. Zero means that the token or the
+ * end of the element has been reached.
+ */
+size_t PageElement::_prefix(char* buffer, size_t length) {
+  size_t  n = 0;
+
+  if (_raw._storage == TokenSource::STORAGE_CLASS_t::FILE && !_file && (!_raw._p || !_openFile())) {
+    _eoe = true;
+    return 0;
+  }
+  while (n < length) {
+    const size_t  len = _literalRead(buffer + n, length - n);
+    if (len) {
+      n += len;
+      continue;
+    }
+    // Look ahead of the delimiter within the current block.
+    char    c[2] = { '\0', '\0' };
+    size_t  ahead = 2;
+    if (_raw._storage == TokenSource::STORAGE_CLASS_t::HEAP) {
+      if ((c[0] = _raw._p[0]))
+        c[1] = _raw._p[1];
+    }
+    else if (_raw._storage == TokenSource::STORAGE_CLASS_t::TEXT) {
+      if ((c[0] = static_cast<char>(pgm_read_byte(_raw._p))))
+        c[1] = static_cast<char>(pgm_read_byte(_raw._p + 1));
+    }
+    else if (_raw._storage == TokenSource::STORAGE_CLASS_t::FILE && _fillFile()) {
+      ahead = std::min(_file->len - _file->pos, ahead);
+      memcpy(c, _file->data + _file->pos, ahead);
+    }
+    if (!c[0]) {
+      _eoe = true;
+      break;
+    }
+    if (ahead < 2 || c[1] == PAGEBUILDER_TOKENDELIMITER_OPEN)
+      break;
+    buffer[n++] = c[0];
+    _literalSkip(1);
+  }
+  return n;
+}
+
+/**
+ * Refill the block buffer of the file: mold if it has been read.
+ * @return  true  The buffer has unread characters.
+ */
+bool PageElement::_fillFile(void) {
+  _FileBufferST&  fb = *_file;
+
+  if (fb.compiled)
+    return _fillCompiled();
+  if (fb.pos >= fb.len && !fb.map) {
+    if (fb.inflate)
+      fb.len = fb.inflate->read(fb.buffer, sizeof(fb.buffer));
+    else {
+      const int rd = fb.file.read(reinterpret_cast<uint8_t*>(fb.buffer), sizeof(fb.buffer));
+      fb.len = rd > 0 ? rd : 0;
+    }
+    fb.pos = 0;
+  }
+  return fb.pos < fb.len;
+}
+
+/**
+ * Refill the block buffer of the precompiled mold. The literal segment
+ * is read in blocks, and the token segment is served with its notation
+ * so that the lexer replaces it.
+ * @return  true  The buffer has unread characters.
+ */
+bool PageElement::_fillCompiled(void) {
+  _FileBufferST&  fb = *_file;
+  _CompiledMoldST&  cm = *fb.compiled;
+
+  if (fb.pos < fb.len)
+    return true;
+  fb.pos = fb.len = 0;
+  while (!cm.remains) {
+    if (cm.next >= cm.count)
+      return false;
+    const uint32_t  segment = cm.segments[cm.next++];
+    if (segment & PAGEELEMENT_PRECOMPILED_TOKEN) {
+      const size_t  id = segment & 0xffff;
+      if (id >= cm.tokens.size())
+        continue;
+      const String& token = cm.tokens[id];
+      fb.buffer[0] = fb.buffer[1] = PAGEBUILDER_TOKENDELIMITER_OPEN;
+      memcpy(fb.buffer + 2, token.c_str(), token.length());
+      fb.len = token.length() + 2;
+      fb.buffer[fb.len++] = PAGEBUILDER_TOKENDELIMITER_CLOSE;
+      fb.buffer[fb.len++] = PAGEBUILDER_TOKENDELIMITER_CLOSE;
+      cm.literal = false;
+      return true;
+    }
+    cm.remains = segment;
+  }
+  const int rd = fb.file.read(reinterpret_cast<uint8_t*>(fb.buffer), std::min(sizeof(fb.buffer), static_cast<size_t>(cm.remains)));
+  if (rd <= 0)
+    return false;
+  fb.len = rd;
+  cm.remains -= rd;
+  cm.literal = true;
+  return true;
+}
+
+/**
+ * Read the header, the token table and the segment table of the
+ * precompiled mold. The file is positioned at the literal area.
+ * @return  true  The precompiled mold is valid.
+ */
+bool PageElement::_openCompiled(void) {
+  _FileBufferST&  fb = *_file;
+  uint8_t header[12];
+
+  if (fb.file.read(header, sizeof(header)) != sizeof(header) || memcmp_P(header, PSTR(PAGEELEMENT_PRECOMPILED_MAGIC), 4)) {
+    PB_DBG("Mold %s is not precompiled\n", _mold);
+    return false;
+  }
+  std::unique_ptr<_CompiledMoldST>  cm(new _CompiledMoldST());
+  const size_t  tokens = header[4] | (header[5] << 8);
+  cm->count = header[6] | (header[7] << 8);
+  _approxSize = header[8] | (header[9] << 8) | (header[10] << 16) | (static_cast<uint32_t>(header[11]) << 24);
+  cm->next = 0;
+  cm->remains = 0;
+  cm->literal = false;
+
+  // The token name must be served within the block buffer.
+  cm->tokens.reserve(tokens);
+  for (size_t i = 0; i < tokens; i++) {
+    const int len = fb.file.read();
+    if (len < 0 || len > static_cast<int>(sizeof(fb.buffer)) - 4 || fb.file.read(reinterpret_cast<uint8_t*>(fb.buffer), len) != static_cast<size_t>(len))
+      return false;
+    cm->tokens.push_back(String());
+    cm->tokens.back().concat(fb.buffer, len);
+  }
+
+  cm->segments.reset(new (std::nothrow) uint32_t[cm->count]);
+  if (!cm->segments)
+    return false;
+  for (size_t i = 0; i < cm->count; i++) {
+    uint8_t le[4];
+    if (fb.file.read(le, sizeof(le)) != sizeof(le))
+      return false;
+    cm->segments[i] = le[0] | (le[1] << 8) | (le[2] << 16) | (static_cast<uint32_t>(le[3]) << 24);
+  }
+  fb.compiled = std::move(cm);
+  return true;
+}
+
+/**
+ * Release the mapping of the mold.
+ */
+PageElement::_FileBuffer::~_FileBuffer() {
+  if (!map)
+    return;
+#if defined(PB_MOLD_MAPPED)
+  munmap(const_cast<void*>(map), mapLength);
+#elif defined(ARDUINO_ARCH_ESP32)
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_partition_munmap(mapHandle);
+#else
+  spi_flash_munmap(mapHandle);
+#endif
+#endif
+}
+
+/**
+ * Map the mold into the memory as a single block. The lexer scans the
+ * mapped mold in place without copying it into the block buffer. The
+ * precompiled mold is not mapped since its segments are served in
+ * order through the block buffer.
+ * @return  true  The mold is mapped.
+ */
+bool PageElement::_mapFile(void) {
+  _FileBufferST&  fb = *_file;
+
+#if defined(PB_MOLD_MAPPED)
+  const String  path = String(F(PAGEELEMENT_MAPPED_ROOT)) + _mold;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  void* map = MAP_FAILED;
+  // An empty file cannot be mapped, it is read through the File API.
+  if (!fstat(fd, &st) && st.st_size > 0)
+    map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+  fb.map = map;
+  fb.mapLength = fb.len = st.st_size;
+
+#elif defined(ARDUINO_ARCH_ESP32)
+  if (!_partition)
+    return false;
+  const esp_partition_t*  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, _mold);
+  if (!partition)
+    return false;
+  const void* map;
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_partition_mmap_handle_t handle;
+#else
+  spi_flash_mmap_handle_t handle;
+#endif
+  if (esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &map, &handle) != ESP_OK) {
+    PB_DBG("Partition %s mapping failed\n", _mold);
+    return false;
+  }
+  fb.map = map;
+  fb.mapHandle = handle;
+  fb.mapLength = partition->size;
+  // The mold ends with the null or at the erased area.
+  const char* p = static_cast<const char*>(map);
+  size_t  len = 0;
+  while (len < fb.mapLength && p[len] && p[len] != '\xff')
+    len++;
+  fb.len = len;
+
+#else
+  (void)(fb);
+  return false;
+#endif
+
+  fb.data = static_cast<const char*>(fb.map);
+  _approxSize = fb.len;
+  PB_DBG("_mold %s mapped %u, ", _mold, fb.len);
+  return true;
+}
+
+/**
+ * Open the file: mold and allocate the block buffer for it. The mold
+ * is mapped into the memory if the platform allows it, otherwise it is
+ * read through the File API. The compressed mold is decompressed into
+ * the block buffer.
+ * @return  true  The mold file is opened.
+ */
+bool PageElement::_openFile(void) {
+  PB_DBG_DUMB("\n");
+  if (_loadPending)
+    _loadFile();
+  _file.reset(new _FileBufferST());
+  _file->pos = 0;
+  _file->len = 0;
+  _file->data = _file->buffer;
+  if (_compressed) {
+    _file->inflate.reset(new (std::nothrow) PageInflate(_mold, _moldLength));
+    if (_file->inflate && _file->inflate->begin())
+      return true;
+    PB_DBG("Compressed mold inflation failed, free:%u\n", ESP.getFreeHeap());
+    _file.reset();
+    return false;
+  }
+  if (!_compiled && _mapFile())
+    return true;
+  if (_partition) {
+    PB_DBG("_mold %s not mapped", _mold);
+    _file.reset();
+    return false;
+  }
+  File  mf = PageBuilderFS::flash.open(_mold, "r");
+  if (!mf) {
+    PB_DBG("_mold %s open failed", _mold);
+    _file.reset();
+    return false;
+  }
+  PB_DBG("_mold %s opened, ", mf.name());
+  _file->file = mf;
+  // The file can be replaced after the loading.
+  if (!_compiled)
+    _approxSize = mf.size();
+  if (_compiled && !_openCompiled()) {
+    PB_DBG("_mold %s broken", _mold);
+    _file.reset();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Copy the mold and the tokens of the element. The scanning state is
+ * not copied, the element is read from the beginning.
+ * @param   element   Source element
+ * @return  Reference of the element
+ */
+PageElement& PageElement::operator=(const PageElement& element) {
+  if (this != &element) {
+    rewind();
+    _reserveSize = element._reserveSize;
+    _sources = element._sources;
+    _deadlines = element._deadlines;
+    _copyMold(element);
+  }
+  return *this;
+}
+
+/**
+ * Copy the mold of the element. The minified mold is duplicated so that
+ * it does not refer to the cache of the source element.
+ * @param   element   Source element
+ */
+void PageElement::_copyMold(const PageElement& element) {
+  _approxSize = element._approxSize;
+  _mold = element._mold;
+  _storage = element._storage;
+  _minify = element._minify;
+  _loadPending = element._loadPending;
+  _partition = element._partition;
+  _compressed = element._compressed;
+  _moldLength = element._moldLength;
+  _compiled = element._compiled;
+  _cache.reset();
+  if (element._cache) {
+    const size_t  len = strlen(element._cache.get());
+    _cache.reset(new char[len + 1]);
+    memcpy(_cache.get(), element._cache.get(), len + 1);
+    _mold = _cache.get();
+  }
+}
+
+/**
+ * Minify the mold. The heap mold is minified immediately, and the file:
+ * mold is minified when it is first opened. The molds set afterward
+ * are also minified. Disabling does not restore the minified mold.
+ * @param   enable  Minify the mold at loading.
+ */
+void PageElement::minify(const bool enable) {
+  _minify = enable;
+  if (_minify && !_cache) {
+    if (_storage == TokenSource::STORAGE_CLASS_t::HEAP && _mold) {
+      _minifyHeap();
+      _approxSize = strlen(_mold);
+    }
+    else if (_storage == TokenSource::STORAGE_CLASS_t::FILE && !_partition && !_compressed)
+      _loadPending = true;
+  }
+}
+
+/**
+ * Minify the heap mold into the cache which the element owns. The mold
+ * that the cache already holds is minified in place, otherwise it is
+ * copied into the cache once and minified there.
+ * @return  true  The mold has been replaced with the minified one.
+ */
+bool PageElement::_minifyHeap(void) {
+  const size_t  len = strlen(_mold);
+  if (!_cache || _mold != _cache.get()) {
+    std::unique_ptr<char[]> copy(new (std::nothrow) char[len + 1]);
+    if (!copy) {
+      PB_DBG("Mold minification failed, free:%u\n", ESP.getFreeHeap());
+      return false;
+    }
+    memcpy(copy.get(), _mold, len + 1);
+    _cache = std::move(copy);
+    _mold = _cache.get();
+  }
+  const size_t  mlen = PageMinify::minify(_cache.get(), _cache.get(), len);
+  _cache[mlen] = '\0';
+  PB_DBG("Mold minified %u -> %u\n", len, mlen);
+  return true;
+}
+
+/**
+ * Minify the file: mold into the cache file with the suffix, and the
+ * mold is replaced with the cache file. The cache file that was written
+ * after the mold was last modified is reused without rewriting it.
+ * @return  true  The mold has been replaced with the minified file.
+ */
+bool PageElement::_minifyFile(void) {
+  const String  path = String(_mold) + String(F(PAGEELEMENT_MINIFIED_SUFFIX));
+  File  src = PageBuilderFS::flash.open(_mold, "r");
+  if (!src)
+    return false;
+  File  dst = PageBuilderFS::flash.open(path, "r");
+  // The minified file never exceeds the mold.
+  const bool  fresh = dst && dst.getLastWrite() >= src.getLastWrite() && dst.size() <= src.size();
+  if (dst)
+    dst.close();
+  if (fresh)
+    PB_DBG("Mold %s minified already\n", _mold);
+  else {
+    dst = PageBuilderFS::flash.open(path, "w");
+    if (!dst) {
+      PB_DBG("Minified %s open failed\n", path.c_str());
+      src.close();
+      return false;
+    }
+    const bool  minified = PageMinify::minify(dst, src);
+    PB_DBG("Mold %s minified %u -> %u\n", _mold, src.size(), dst.size());
+    dst.close();
+    if (!minified) {
+      src.close();
+      PageBuilderFS::flash.remove(path);
+      return false;
+    }
+  }
+  src.close();
+  _cache.reset(new char[path.length() + 1]);
+  memcpy(_cache.get(), path.c_str(), path.length() + 1);
+  _mold = _cache.get();
+  return true;
+}
+
+/**
+ * Prepare the file: mold at the first opening. The precompiled mold
+ * takes the place of the file if it is not older than the file,
+ * otherwise the HTML file is minified if enabled. The approximate size
+ * is taken from the literals of the precompiled mold, or from the file
+ * which will be read.
+ */
+void PageElement::_loadFile(void) {
+  _loadPending = false;
+  const String  path = String(_mold) + String(F(PAGEELEMENT_PRECOMPILED_SUFFIX));
+  if (PageBuilderFS::flash.exists(path)) {
+    File  cf = PageBuilderFS::flash.open(path, "r");
+    File  mf = PageBuilderFS::flash.open(_mold, "r");
+    // The precompiled mold can be deployed without the mold.
+    const bool  fresh = cf && (!mf || cf.getLastWrite() >= mf.getLastWrite());
+    uint8_t header[12];
+    if (fresh && cf.read(header, sizeof(header)) == sizeof(header)) {
+      PB_DBG("Mold %s precompiled\n", path.c_str());
+      _cache.reset(new char[path.length() + 1]);
+      memcpy(_cache.get(), path.c_str(), path.length() + 1);
+      _mold = _cache.get();
+      _compiled = true;
+      // The total length of the literals follows the counts.
+      _approxSize = header[8] | (header[9] << 8) | (header[10] << 16) | (static_cast<uint32_t>(header[11]) << 24);
+    }
+    else {
+      PB_DBG("Precompiled %s is stale\n", path.c_str());
+    }
+    if (cf)
+      cf.close();
+    if (mf)
+      mf.close();
+    if (_compiled)
+      return;
+  }
+  if (_minify && _isHtml(_mold))
+    _minifyFile();
+
+  File  mf = PageBuilderFS::flash.open(_mold, "r");
+  if (mf) {
+    _approxSize = mf.size();
+    mf.close();
+  }
+}
+
 /**
  * Reset the scanning address of the mold,
  * also the token replacement string.
  */
 void PageElement::rewind(void) {
-  while (!_indexStack.empty())
-    _indexStack.pop();
+  while (_depth)
+    _indexStack[--_depth]._fillin = String();
+  // The file: mold restarts from the beginning.
+  if (_file) {
+    _file->file.close();
+    _file.reset();
+  }
+  _raw._fillin = String();
   _raw._storage = _storage;
   _raw._s = 0;
   _raw._p = _mold;
   _sub_c = '\0';
+  _back_c = '\0';
   _eoe = false;
 }
 
@@ -323,14 +1248,37 @@ void PageElement::rewind(void) {
  * @param  mold   const char* mold string
  */
 void PageElement::setMold(const char* mold) {
+  // The former cache is released after the mold has been settled, since
+  // the given mold can be in it.
+  std::unique_ptr<char[]> former(std::move(_cache));
+  _loadPending = false;
+  _partition = false;
+  _compressed = false;
+  _compiled = false;
+#if defined(PAGEELEMENT_TOKENIDENTIFIER_PARTITION)
+  if (!strncmp(mold, PAGEELEMENT_TOKENIDENTIFIER_PARTITION, strlen(PAGEELEMENT_TOKENIDENTIFIER_PARTITION))) {
+    _mold = mold + strlen(PAGEELEMENT_TOKENIDENTIFIER_PARTITION);
+    _storage = TokenSource::FILE;
+    _partition = true;
+    _approxSize = 0;
+  }
+  else
+#endif
   if (strncmp(mold, PAGEELEMENT_TOKENIDENTIFIER_FILE, strlen(PAGEELEMENT_TOKENIDENTIFIER_FILE))) {
     _mold = mold;
     _storage = TokenSource::HEAP;
+    // The mold in the former cache keeps it.
+    if (former && mold >= former.get() && mold <= former.get() + strlen(former.get()))
+      _cache = std::move(former);
+    if (_minify)
+      _minifyHeap();
     _approxSize = strlen(_mold);
   }
   else {
     _mold = mold + strlen(PAGEELEMENT_TOKENIDENTIFIER_FILE);
     _storage = TokenSource::FILE;
+    _loadPending = true;
+    _approxSize = 0;
   }
 }
 
@@ -339,11 +1287,36 @@ void PageElement::setMold(const char* mold) {
  * @param   mold   __FlashStringHelper class
  */
 void PageElement::setMold(const __FlashStringHelper* mold) {
+  _cache.reset();
+  _loadPending = false;
+  _partition = false;
+  _compressed = false;
+  _compiled = false;
   _mold = reinterpret_cast<PGM_P>(mold);
   _storage = TokenSource::TEXT;
   _approxSize = strlen_P(_mold);
 }
 
+/**
+ * Save the mold compressed in the gzip format that is stored in the
+ * PROGMEM, such as the array generated by tools/pbdeflate.py. The mold
+ * is decompressed while being read, and the minification is not
+ * applied to it.
+ * @param   mold    Compressed mold
+ * @param   length  Length of the compressed mold
+ */
+void PageElement::setMold(const uint8_t* mold, const size_t length) {
+  _cache.reset();
+  _loadPending = false;
+  _partition = false;
+  _compressed = true;
+  _compiled = false;
+  _mold = reinterpret_cast<PGM_P>(mold);
+  _moldLength = length;
+  _storage = TokenSource::FILE;
+  _approxSize = PageInflate::size(_mold, length);
+}
+
 /**
  * Default constructor.
  * Assign a PageBuilder instance with an empty PageElement.
@@ -351,7 +1324,7 @@ void PageElement::setMold(const __FlashStringHelper* mold) {
 PageBuilder::PageBuilder()
 : _elements(PageElementVT())
 , _method(HTTP_ANY)
-, _noCache(false)
+, _cachePolicy(NoControl)
 , _cancel(false)
 , _enc(Auto)
 {}
@@ -369,7 +1342,7 @@ PageBuilder::PageBuilder(PageElementVT elements, HTTPMethod method, bool noCache
 : _elements(elements)
 , _method(method)
 , _cors(CORS)
-, _noCache(noCache)
+, _cachePolicy(noCache ? NoCache : NoControl)
 , _cancel(cancel)
 , _enc(chunked)
 {}
@@ -389,7 +1362,7 @@ PageBuilder::PageBuilder(const char* uri, PageElementVT elements, HTTPMethod met
 , _elements(elements)
 , _method(method)
 , _cors(CORS)
-, _noCache(noCache)
+, _cachePolicy(noCache ? NoCache : NoControl)
 , _cancel(cancel)
 , _enc(chunked)
 {}
@@ -421,6 +1394,50 @@ void PageBuilder::authentication(const char* username, const char* password, con
   _auth = scheme;
 }
 
+/**
+ * Set the cache policy of the response. The header block is composed
+ * at the next response.
+ * @param   policy  The cache policy.
+ * @param   maxAge  max-age directive in seconds for the cacheable policy.
+ */
+void PageBuilder::setCache(const CachePolicy_t policy, const unsigned long maxAge) {
+  _cachePolicy = policy;
+  _maxAge = maxAge;
+  _cacheHeader = String();
+}
+
+/**
+ * Compose the value of the Cache-Control header according to the
+ * cacheable policy. The no-cache policy sends the fixed headers of
+ * _headersNocache composed at the first response instead.
+ */
+void PageBuilder::_composeHeaders(void) {
+  _cacheHeader = String();
+  if (_cachePolicy != NoCache && _cachePolicy != NoControl) {
+    _cacheHeader = _cachePolicy == Private ? F("private") : F("public");
+    _cacheHeader += F(",max-age=");
+    _cacheHeader += String(_maxAge);
+    if (_cachePolicy == Immutable)
+      _cacheHeader += F(",immutable");
+  }
+}
+
+/**
+ * Let the WebServer collect the request headers that PageBuilder refers
+ * to. The WebServer keeps only the collected headers, and the
+ * collection replaces the previous one, so the headers that the sketch
+ * refers to should be given together.
+ * @param   server          Reference of the WebServer.
+ * @param   headerKeys      Additional headers to collect.
+ * @param   headerKeysCount Number of the additional headers.
+ */
+void PageBuilder::collectHeaders(WebServer& server, const char* headerKeys[], const size_t headerKeysCount) {
+  std::vector<const char*>  keys(std::begin(_requestHeaders), std::end(_requestHeaders));
+  for (size_t i = 0; i < headerKeysCount; i++)
+    keys.push_back(headerKeys[i]);
+  server.collectHeaders(keys.data(), keys.size());
+}
+
 /**
  * Construct an HTML content, build it as String.
  * @param   content   Building content store buffer
@@ -562,50 +1579,178 @@ bool PageBuilder::handle(WebServer& server, HTTPMethod requestMethod, PageBuilde
   PB_DBG("HTTP_%s %s\n", _httpMethod, requestUri.c_str());
 #endif
 
-  if (!canHandle(requestMethod, requestUri))
-    return false;
+  PB_TRACE_SPAN("request", requestUri);
+  {
+    PB_TRACE_SPAN("canHandle", requestUri);
+    if (!canHandle(requestMethod, requestUri))
+      return false;
+  }
+  return _respond(server);
+}
+
+/**
+ * Respond to the request that has been identified as this page is
+ * responsible for it, with the certification.
+ * @param  server   Reference of the calling WebServer instance
+ * @param  params   Additional arguments such as the path parameters
+ * captured by the PageRouter. It can be nullptr.
+ * @return true   sent successfull
+ */
+bool PageBuilder::_respond(WebServer& server, const PageArgument* params) {
+  bool  issue;
+  if (!_authenticate(server, issue))
+    return true;
+
+  // Reset the sending cancel, invoke the content generating and send
+  _cancel = false;
+  _handle(200, server, params, issue);
+  if (_cancel) {
+    PB_DBG("Send canceled\n");
+  }
+  return true;
+}
 
+/**
+ * Certify the request with the authentication of the page. If the
+ * certification fails, the authentication is requested to the client.
+ * @param  server   Reference of the calling WebServer instance
+ * @param  issue    Returns true if the session should be issued with
+ * the response, since the request is certified by the credentials.
+ * @return true   The request is certified or the page has no authentication.
+ * @return false  The authentication has been requested.
+ */
+bool PageBuilder::_authenticate(WebServer& server, bool& issue) {
+  issue = false;
   if (_username.length()) {
+    PB_TRACE_SPAN("authenticate", _username);
     PB_DBG("auth:%s", _username.c_str());
     if (_password.length()) {
       PB_DBG_DUMB("/%s", _password.c_str());
     }
     PB_DBG_DUMB(" %s", _auth == HTTPAuthMethod::BASIC_AUTH ? "basic" : "digest");
+    // The request with the valid session cookie skips the credential
+    // check, and the session is issued after the certification with
+    // the response that has been admitted.
+    if (_session && _session->_verify(server, _username, _password)) {
+      PB_DBG_DUMB(" session\n");
+      return true;
+    }
     if (!server.authenticate(_username.c_str(), _password.c_str())) {
       PB_DBG_DUMB(" failure\n");
       server.requestAuthentication(_auth, _realm.c_str(), _fails);
-      return true;
+      return false;
     }
+    issue = _session != nullptr;
     PB_DBG_DUMB("\n");
   }
-
-  // Reset the sending cancel, invoke the content generating and send
-  _cancel = false;
-  _handle(200, server);
-  if (_cancel) {
-    PB_DBG("Send canceled\n");
-  }
   return true;
 }
 
 /**
  * The actual existence of the URL handler function called from
- * the WebServer instance.
+ * the WebServer instance. The rendering is admitted by the global and
+ * the page controllers with the predicted heap consumption, otherwise
+ * the request is shed before anything is built.
  * @param   code    HTTP code to respond to the request.
  * @param   server  Reference of the WebServer instance.
+ * @param   params  Additional arguments that take precedence over the
+ * requested arguments.
+ * @param   issue   Issue the session cookie with the admitted response.
  */
-void PageBuilder::_handle(int code, WebServer& server) {
+void PageBuilder::_handle(int code, WebServer& server, const PageArgument* params, const bool issue) {
+  // The size of the file: mold is known after it has been loaded.
+  for (auto& element : _elements) {
+    PageElement&  pe = element.get();
+    if (pe._loadPending)
+      pe._loadFile();
+  }
+  size_t  wholeSize;
+  size_t  elementSize;
+  _predictSize(wholeSize, elementSize);
+  TransferEncoding_t  enc = _enc == Auto ? _selectEncoding(wholeSize, elementSize) : _enc;
+  // The early flush streams the content since the identity holds the
+  // whole content until it has been built.
+  if (enc == Identity && _earlyFlush && !_exactLength)
+    enc = ByteStream;
+
+  // The identity holds the whole content besides the element being
+  // built, and the streams hold the element and the segment.
+  size_t  demand = elementSize;
+  if (enc == Identity)
+    demand += wholeSize;
+  else
+    demand += PAGEBUILDER_TRANSMIT_SEGMENT_SIZE * (_pipeline ? 2 : 1);
+
+  // The page controller is consulted first, so the request that it
+  // sheds is not counted as admitted by the global one.
+  PageAdmission&  global = PageAdmission::global();
+  if (_admission && !_admission->_admit(demand)) {
+    _admission->_reject(server);
+    return;
+  }
+  if (!global._admit(demand)) {
+    if (_admission)
+      _admission->_revoke(demand);
+    global._reject(server);
+    return;
+  }
+  // The request that has been shed is not given the session.
+  if (issue)
+    _session->_issue(server, _username, _password);
+  _render(code, server, params, enc);
+  if (_admission)
+    _admission->_release(demand);
+  global._release(demand);
+}
+
+/**
+ * Build the content of the page and send it.
+ * @param   code    HTTP code to respond to the request.
+ * @param   server  Reference of the WebServer instance.
+ * @param   params  Additional arguments that take precedence over the
+ * requested arguments.
+ * @param   enc     Transfer encoding to apply for this response.
+ */
+void PageBuilder::_render(int code, WebServer& server, const PageArgument* params, const TransferEncoding_t enc) {
   PageArgument  args;
 
   // Make a set of requested arguments
-  for (uint8_t i = 0; i < server.args(); i++)
-    args.push(server.argName(i), server.arg(i));
+  {
+    PB_TRACE_SPAN("arguments", nullptr);
+    for (uint8_t i = 0; i < server.args(); i++)
+      args.push(server.argName(i), server.arg(i));
+    if (params) {
+      for (size_t i = 0; i < params->size(); i++)
+        args.push(params->argName(i), params->arg(i));
+    }
+  }
+  args._start = millis();
+  args._budget = _budget;
 
-  if (_noCache)
-    for (auto& httpHeader : _headersNocache) {
-      server.sendHeader(String(FPSTR(httpHeader.name)), String(FPSTR(httpHeader.value)));
+  // The cache control headers are composed once and reused. The fixed
+  // no-cache headers are shared by all pages, and the Cache-Control
+  // of the other policies is composed for each page.
+  if (_cachePolicy != NoControl) {
+    static const std::vector<String>  headersNocache = []() {
+      std::vector<String> headers;
+      for (auto& httpHeader : _headersNocache) {
+        headers.emplace_back(FPSTR(httpHeader.name));
+        headers.emplace_back(FPSTR(httpHeader.value));
+      }
+      return headers;
+    }();
+    if (_cachePolicy == NoCache) {
+      for (size_t i = 0; i < headersNocache.size(); i += 2)
+        server.sendHeader(headersNocache[i], headersNocache[i + 1]);
+    }
+    else {
+      if (!_cacheHeader.length())
+        _composeHeaders();
+      // The no-cache headers lead with the name of the Cache-Control.
+      server.sendHeader(headersNocache[0], _cacheHeader);
     }
-  
+  }
+
   // Include Access-Control-Allow-Origin in the response header according to the
   // _cors member of the current page. By default, _cors is false and the
   // response header typically has no "Access-Control-Allow-Origin".
@@ -614,21 +1759,65 @@ void PageBuilder::_handle(int code, WebServer& server) {
   PB_DBG("%s enable CORS: %s\n", _uri.c_str(), _cors ? "true" : "false");
   server.enableCORS(_cors);
 
-  if (_enc == Auto) {
-    // TransferEncoding:Auto
+  // The page that exposes the tokens responds with their values
+  // instead of the content when the tokens are requested.
+  if (_exposeTokens && server.hasArg(F(PAGEBUILDER_TOKENS_ARG))) {
+    _sendTokens(code, server, args);
+    return;
+  }
+
+  // The page consisting of a token-free file: mold is sent as it is,
+  // and it can respond to the range request. The token-free compressed
+  // mold is also sent as it is to the client that accepts the gzip.
+  if (code == 200 && (_sendFile(server) || _sendCompressed(server)))
+    return;
+
+  // The independent token handlers are evaluated in parallel while
+  // the content is being built. With the early flush, they are
+  // dispatched after the prefix has been sent.
+  const bool  early = _earlyFlush && !_exactLength && enc != Identity;
+  PagePrefetch  prefetch;
+  if (_preEvaluate && !early) {
+    prefetch.dispatch(_elements, args);
+    args._prefetch = &prefetch;
+  }
+
+  if (enc == Identity) {
+    // TransferEncoding:Identity
     // PageBuilder generates the whole content of the page into a String
-    // instance at once. If If its size exceeds PAGEBUILDER_CONTENTBLOCK_SIZE,
-    // it will try to output the stream via streamFile. In that case,
-    // Transfer-encoding will be chunked.
+    // instance at once. If its size exceeds PAGEBUILDER_CONTENTBLOCK_SIZE,
+    // it will be written to the client in blocks with the Content-Length.
+    // When the heap runs out in the middle of the building, the response
+    // degrades to the chunked stream that continues from where the
+    // building stopped, so the content is not lost.
     String  contentBlock;
-    build(contentBlock, args);
-    if (!_cancel) {
+    String  elementBlock;
+    size_t  rSize = _reserveSize;
+    if (!rSize)
+      rSize = _getApproxSize();
+    size_t  n = 0;
+    bool    resume = false;
+    if (contentBlock.reserve(rSize)) {
+      for (; n < _elements.size(); n++) {
+        PageElement&  pe = _elements[n].get();
+        pe.build(elementBlock, args);
+        if (_cancel)
+          return;
+        if (!pe._eoe || !contentBlock.concat(elementBlock)) {
+          resume = true;
+          break;
+        }
+      }
+    }
+
+    if (n == _elements.size()) {
+      PB_TRACE_SPAN("send", nullptr);
       if (contentBlock.length() > PAGEBUILDER_CONTENTBLOCK_SIZE) {
         char  wrBuf[PAGEBUILDER_CONTENTBLOCK_SIZE];
         WiFiClient  client = server.client();
         PageStream  content(contentBlock, client);
         server.setContentLength(contentBlock.length());
-        server.send(200, "text/html", "");
+        server.send(code, "text/html", "");
         while (content.available() > 0) {
           size_t  nRd = content.readBytes(wrBuf, sizeof(wrBuf));
           client.write(wrBuf, nRd);
@@ -637,21 +1826,89 @@ void PageBuilder::_handle(int code, WebServer& server) {
       else
         server.send(code, "text/html", contentBlock);
       PB_DBG("blk:%u\n", contentBlock.length());
+      return;
+    }
+
+    PB_DBG("Degraded to chunked at %u, free:%u\n", contentBlock.length() + elementBlock.length(), ESP.getFreeHeap());
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(code, "text/html", "");
+    // The content built so far is sent as it is and released before
+    // the output stage allocates the segment buffer.
+    if (contentBlock.length())
+      server.sendContent(contentBlock);
+    contentBlock = String();
+    if (elementBlock.length())
+      server.sendContent(elementBlock);
+    elementBlock = String();
+    PageOutput  output(server, _flush);
+    if (!output.begin()) {
+      PB_DBG("Output unbuffered, free:%u\n", ESP.getFreeHeap());
+    }
+    bool  firstOrder = false;
+    for (size_t i = n; i < _elements.size(); i++) {
+      PageElement&  pe = _elements[i].get();
+      // The element that stopped building is resumed as it is.
+      if (i != n || !resume)
+        pe.rewind();
+      if (!_sendStream(code, server, output, pe, args, firstOrder))
+        break;
     }
+    output.flush();
+    server.sendContent("");
   }
 
-  else if (_enc == Chunked || _enc == ByteStream) {
+  else if (enc == Chunked || enc == ByteStream) {
     // TransferEncoding:Chunked or ByteStream
     // Chunk transmission applies to both of these transmission schemes.
+    // The content is coalesced into segments by the output stage.
     PB_DBG("Chunked, ");
     bool  firstOrder = true;
-    if (_enc == Chunked) {
-      // Chunks generate and send a page segment for each element of
-      // PageElements. PageBuilder needs enough heap space to store a
-      // segment of the page content into a String instance.
-      for (auto& element : _elements) {
+    PageOutput  output(server, _flush);
+    if (!output.begin(_pipeline)) {
+      PB_DBG_DUMB("unbuffered, free:%u, ", ESP.getFreeHeap());
+    }
+    // The content is measured in advance with the token values that are
+    // memoized for the streaming, and it is sent with the Content-Length.
+    std::vector<String> memo;
+    if (_exactLength) {
+      size_t  contentLength = 0;
+      args._memo = &memo;
+      args._record = true;
+      for (auto& element : _elements)
+        contentLength += element.get()._measure(args);
+      if (_cancel)
+        return;
+      args._record = false;
+      PB_DBG_DUMB("length:%u, ", contentLength);
+      server.setContentLength(contentLength);
+      server.send(code, "text/html", "");
+      firstOrder = false;
+    }
+    // The headers and the literal prefix of the page are sent before any
+    // token handler runs, and the element in which the prefix stopped
+    // is resumed as it is.
+    size_t  n = 0;
+    bool    resume = false;
+    if (early) {
+      n = _sendPrefix(code, server, output);
+      resume = n < _elements.size();
+      firstOrder = false;
+      if (_preEvaluate) {
+        prefetch.dispatch(_elements, args);
+        args._prefetch = &prefetch;
+      }
+    }
+    for (size_t i = n; i < _elements.size(); i++) {
+      PageElement&  pe = _elements[i].get();
+      const bool    resumed = resume && i == n;
+      if (enc == Chunked && !resumed) {
+        // Chunks generate a page segment for each element of PageElements.
+        // PageBuilder needs enough heap space to store a segment of the
+        // page content into a String instance. If the heap runs out in
+        // the middle of the segment, the rest of the element continues
+        // to be streamed the same as ByteStream.
         String  contentBlock;
-        size_t  blkSize = element.get().build(contentBlock, args);
+        pe.build(contentBlock, args);
         if (_cancel)
           return;
         else if (firstOrder) {
@@ -659,58 +1916,302 @@ void PageBuilder::_handle(int code, WebServer& server) {
           server.send(code, "text/html", "");
           firstOrder = false;
         }
-        server.sendContent_P(contentBlock.c_str());
-        (void)(blkSize);
-        PB_DBG("blk:%u\n", blkSize);
-        server.client().flush();
-      }
-    }
-    else {
-      // ByteStream sending is similar to a chunk, creates a segment of
-      // the page for each content element, but not through a String
-      // instance. It allocates a fixed-length buffer and reuses it, so
-      // it consumes less heap space regardless of HTML generating size.
-      char* cBuffer = reinterpret_cast<char*>(malloc(PAGEBUILDER_CONTENTBLOCK_SIZE));
-      if (cBuffer) {
-        char* bp = cBuffer;
-        size_t  cBufferLen = PAGEBUILDER_CONTENTBLOCK_SIZE;
-        for (auto& element : _elements) {
-          PageElement&  pe = element.get();
-          pe.rewind();
-          size_t  blkSize = pe.build(bp, cBufferLen, args);
-          if (_cancel) {
-            free(cBuffer);
-            return;
-          }
-          else if (firstOrder) {
-            server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-            server.send(code, "text/html", "");
-            firstOrder = false;
-          }
-          while (blkSize) {
-            server.sendContent_P(cBuffer, blkSize);
-            PB_DBG_DUMB("blk:%u ", blkSize);
-            bp += blkSize;
-            cBufferLen -= blkSize;
-            if (!cBufferLen) {
-              bp = cBuffer;
-              cBufferLen = PAGEBUILDER_CONTENTBLOCK_SIZE;
-            }
-            server.client().flush();
-            blkSize = pe.build(bp, cBufferLen, args);
-          }
-        }
-        free(cBuffer);
-        PB_DBG_DUMB("\n");
+        output.write(contentBlock.c_str(), contentBlock.length());
+        if (pe._eoe)
+          continue;
       }
       else {
-        PB_DBG_DUMB("failed, free:%u\n", ESP.getFreeHeap());
+        // ByteStream sending is similar to a chunk, creates a segment of
+        // the page for each content element, but not through a String
+        // instance. The content is built directly into the segment buffer
+        // of the output stage, so it consumes less heap space regardless
+        // of HTML generating size.
+        if (!resumed)
+          pe.rewind();
       }
+      if (!_sendStream(code, server, output, pe, args, firstOrder))
+        return;
     }
+    output.flush();
+    PB_DBG_DUMB("\n");
     server.sendContent("");
   }
 }
 
+/**
+ * Predict the size of the content with the margin for the token
+ * replacement.
+ * @param   wholeSize   Returns the size of the whole content.
+ * @param   elementSize Returns the size of the largest element.
+ */
+void PageBuilder::_predictSize(size_t& wholeSize, size_t& elementSize) const {
+  wholeSize = _reserveSize ? _reserveSize : _getApproxSize();
+  elementSize = 0;
+  for (auto& element : _elements)
+    elementSize = std::max(elementSize, element.get().getApproxSize());
+  // Tokens expand the content beyond the approximate size.
+  wholeSize += wholeSize >> 2;
+  elementSize += elementSize >> 2;
+}
+
+/**
+ * Select the transfer encoding for the Auto. The whole content is sent
+ * at once if the largest free block of the heap can accommodate it with
+ * the margin for the token replacement, the chunks of each element if
+ * the largest element fits, otherwise the byte stream that does not
+ * depend on the content size.
+ * @param   wholeSize   Predicted size of the whole content.
+ * @param   elementSize Predicted size of the largest element.
+ * @return  Transfer encoding to apply for this response.
+ */
+PageBuilder::TransferEncoding_t PageBuilder::_selectEncoding(const size_t wholeSize, const size_t elementSize) const {
+  const size_t  freeHeap = ESP.getFreeHeap();
+  const size_t  maxBlock = PageBuilderUtil::maxFreeBlock();
+  const size_t  wholeDemand = wholeSize + PAGEBUILDER_HEAP_RESERVE;
+  const size_t  elementDemand = elementSize + PAGEBUILDER_HEAP_RESERVE + PAGEBUILDER_TRANSMIT_SEGMENT_SIZE;
+
+  PB_DBG("Predicted:%u, free:%u, max:%u\n", wholeDemand, freeHeap, maxBlock);
+  if (wholeDemand <= maxBlock && wholeDemand + elementDemand <= freeHeap)
+    return Identity;
+  if (elementDemand <= maxBlock)
+    return Chunked;
+  return ByteStream;
+}
+
+/**
+ * Stream the rest of the element into the output stage. The response
+ * header is sent at the first block if it has not been sent yet.
+ * @param   code        HTTP code to respond to the request.
+ * @param   server      Reference of the WebServer instance.
+ * @param   output      The output stage.
+ * @param   element     The element being built.
+ * @param   args        Arguments to be passed to the token handler.
+ * @param   firstOrder  The response header has not been sent yet.
+ * @return  false   Sending was canceled.
+ */
+bool PageBuilder::_sendStream(int code, WebServer& server, PageOutput& output, PageElement& element, PageArgument& args, bool& firstOrder) {
+  size_t  blkSize;
+
+  do {
+    blkSize = element.build(output.tail(), output.room(), args);
+    if (_cancel)
+      return false;
+    else if (firstOrder) {
+      server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+      server.send(code, "text/html", "");
+      firstOrder = false;
+    }
+    output.commit(blkSize);
+  } while (blkSize);
+  return true;
+}
+
+/**
+ * Send the headers and the literal prefix of the page that precedes the
+ * first token before any token handler runs, so that the client can
+ * start fetching the sub-resources while the tokens are evaluated. The
+ * elements without tokens ahead of it are sent as a whole.
+ * @param   code    HTTP code to respond to the request.
+ * @param   server  Reference of the WebServer instance.
+ * @param   output  Output stage of the response.
+ * @return  Index of the element in which the prefix stopped.
+ */
+size_t PageBuilder::_sendPrefix(int code, WebServer& server, PageOutput& output) {
+  size_t  n = 0;
+
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, "text/html", "");
+  for (; n < _elements.size(); n++) {
+    PageElement&  pe = _elements[n].get();
+    pe.rewind();
+    while (const size_t len = pe._prefix(output.tail(), output.room()))
+      output.commit(len);
+    if (!pe._eoe)
+      break;
+  }
+  output.flush();
+  PB_DBG_DUMB("prefix:%u, ", n);
+  return n;
+}
+
+/**
+ * Send the page that consists of a single compressed mold without
+ * tokens. The compressed mold is sent without the decompression with
+ * the Content-Encoding if the client accepts the gzip.
+ * @param   server  Reference of the WebServer instance.
+ * @return  false   The page is not eligible, it should be built.
+ */
+bool PageBuilder::_sendCompressed(WebServer& server) {
+  if (_elements.size() != 1)
+    return false;
+  PageElement&  pe = _elements.front().get();
+  if (!pe._compressed || pe.hasToken())
+    return false;
+  const bool  gzip = _acceptsGzip(server.header(F("Accept-Encoding")));
+  // Both the gzip and the decompressed content built instead depend on
+  // the encoding that the client accepts.
+  server.sendHeader(F("Vary"), F("Accept-Encoding"));
+  if (!gzip)
+    return false;
+
+  server.sendHeader(F("Content-Encoding"), F("gzip"));
+  server.setContentLength(pe._moldLength);
+  server.send(200, "text/html", "");
+  PB_DBG("Compressed %u/%u\n", pe._moldLength, pe.getApproxSize());
+  if (server.method() != HTTP_HEAD) {
+    PB_TRACE_SPAN("send", nullptr);
+    server.sendContent_P(pe.mold(), pe._moldLength);
+  }
+  return true;
+}
+
+/**
+ * Send the page that consists of a single file: mold without tokens.
+ * The file is sent as it is with the Content-Length, and a byte range
+ * specified by the Range header is sent as the partial content.
+ * @param   server  Reference of the WebServer instance.
+ * @return  false   The page is not eligible, it should be built.
+ */
+bool PageBuilder::_sendFile(WebServer& server) {
+  if (!_staticFile || _elements.size() != 1)
+    return false;
+  PageElement&  pe = _elements.front().get();
+  if (pe.storage() != TokenSource::STORAGE_CLASS_t::FILE || pe.hasToken() || pe._partition || pe._compressed)
+    return false;
+  // The minified file has been loaded in place of the mold, and the type
+  // is taken from the extension of the mold before its suffix.
+  String  path(pe.mold());
+  if (path.endsWith(F(PAGEELEMENT_MINIFIED_SUFFIX)))
+    path.remove(path.length() - strlen(PAGEELEMENT_MINIFIED_SUFFIX));
+  const char* mime = _mime ? _mime : _contentType(path.c_str());
+  // The precompiled mold is built with the lexer.
+  if (pe._compiled)
+    return false;
+
+  File  mf = PageBuilderFS::flash.open(pe.mold(), "r");
+  if (!mf)
+    return false;
+  PageOutput  output(server, _flush);
+  if (!output.begin()) {
+    PB_DBG("File output unbuffered, free:%u\n", ESP.getFreeHeap());
+  }
+
+  const size_t  size = mf.size();
+  size_t  first = 0;
+  size_t  last = size ? size - 1 : 0;
+  int     range = 0;
+  // If-Range cannot be validated without the entity tag, and the whole
+  // content answers it.
+  if (server.hasHeader(F("Range")) && !server.hasHeader(F("If-Range")))
+    range = _parseRange(server.header(F("Range")), size, first, last);
+  server.sendHeader(F("Accept-Ranges"), F("bytes"));
+  if (range < 0) {
+    PB_DBG("Range %s not satisfiable\n", server.header(F("Range")).c_str());
+    server.sendHeader(F("Content-Range"), String(F("bytes */")) + String(size));
+    server.send(416, "text/plain", "");
+    return true;
+  }
+
+  const size_t  length = size ? last - first + 1 : 0;
+  if (range > 0)
+    server.sendHeader(F("Content-Range"), String(F("bytes ")) + String(first) + '-' + String(last) + '/' + String(size));
+  server.setContentLength(length);
+  server.send(range > 0 ? 206 : 200, mime, "");
+  PB_DBG("File %s %u-%u/%u\n", pe.mold(), first, last, size);
+
+  if (server.method() != HTTP_HEAD && length && mf.seek(first)) {
+    size_t  remains = length;
+    while (remains) {
+      const size_t  n = mf.read(reinterpret_cast<uint8_t*>(output.tail()), std::min(output.room(), remains));
+      if (!n)
+        break;
+      output.commit(n);
+      remains -= n;
+    }
+    output.flush();
+  }
+  mf.close();
+  return true;
+}
+
+/**
+ * Send the values of the requested tokens as a JSON object without
+ * building the content. The tokens argument lists the token names
+ * separated by comma, and all tokens of the page are sent if it is
+ * empty. Only the handlers of the requested tokens are evaluated, and
+ * the token not found in the page is omitted.
+ * @param   code    HTTP code to respond to the request.
+ * @param   server  Reference of the WebServer instance.
+ * @param   args    Arguments to be passed to the token handler.
+ */
+void PageBuilder::_sendTokens(int code, WebServer& server, PageArgument& args) {
+  const String  request = args.arg(PAGEBUILDER_TOKENS_ARG);
+  std::vector<String> names;
+
+  if (request.length()) {
+    int from = 0;
+    while (from <= static_cast<int>(request.length())) {
+      int to = request.indexOf(',', from);
+      if (to < 0)
+        to = request.length();
+      String  name = request.substring(from, to);
+      name.trim();
+      if (name.length() && std::find(names.begin(), names.end(), name) == names.end())
+        names.push_back(name);
+      from = to + 1;
+    }
+  }
+  else {
+    for (auto& element : _elements)
+      for (const TokenSource& source : element.get().tokens()) {
+        const String  name = source.name();
+        if (std::find(names.begin(), names.end(), name) == names.end())
+          names.push_back(name);
+      }
+  }
+
+  PageOutput  output(server, _flush);
+  if (!output.begin()) {
+    PB_DBG("Tokens output unbuffered, free:%u\n", ESP.getFreeHeap());
+  }
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(code, "application/json", "");
+  output.write("{", 1);
+  size_t  count = 0;
+  for (const String& name : names) {
+    const TokenSource*  exchanger = nullptr;
+    for (auto& element : _elements) {
+      for (const TokenSource& source : element.get().tokens())
+        if (source.match(name.c_str())) {
+          exchanger = &source;
+          break;
+        }
+      if (exchanger)
+        break;
+    }
+    if (!exchanger || !exchanger->builder)
+      continue;
+
+    String  pair;
+    PB_TRACE_SPAN("token", name);
+    const String  value = exchanger->builder(args);
+    if (!pair.reserve(name.length() + value.length() + 8))
+      PB_DBG("Token %s reservation failed\n", name.c_str());
+    if (count++)
+      pair += ',';
+    pair += '"';
+    PageEscape::escape(pair, name.c_str(), name.length(), PageEscape::JSON);
+    pair += F("\":\"");
+    PageEscape::escape(pair, value.c_str(), value.length(), PageEscape::JSON);
+    pair += '"';
+    output.write(pair.c_str(), pair.length());
+  }
+  output.write("}", 1);
+  output.flush();
+  server.sendContent("");
+  PB_DBG("Tokens %u sent\n", count);
+}
+
 /**
  * Wrapper for the uploader
  * @param   server      Reference of the WebServer
@@ -10,11 +10,12 @@
 #ifndef _PAGEBUILDER_H_
 #define _PAGEBUILDER_H_
 
+#include <climits>
 #include <tuple>
 #include <type_traits>
 #include <functional>
 #include <forward_list>
-#include <stack>
+#include <memory>
 #include <vector>
 #include <iterator>
 #if defined(ARDUINO_ARCH_ESP8266)
@@ -25,6 +26,9 @@ using WebServer = ESP8266WebServer;
 #include <WiFi.h>
 #include <WebServer.h>
 #endif
+#include "PageEscape.h"
+#include "PageFormat.h"
+#include "PageInflate.h"
 
 // Uncomment the following PB_DEBUG to enable debug output.
 // #define PB_DEBUG
@@ -105,6 +109,9 @@ using WebServer = ESP8266WebServer;
 #endif
 #endif
 
+// The file system instance applied to the file: mold and the uploader.
+namespace PageBuilderFS { extern PB_APPLIED_FILECLASS& flash; }
+
 // The length of one content block is predefined and determined at compilation.
 // The block length affects how the content is sent. If the HTML content
 // of the generated page exceeds this size, PageBuilder will send it
@@ -119,6 +126,30 @@ using WebServer = ESP8266WebServer;
 #endif
 #endif
 
+// The chunked transmission coalesces the content into a chunk of this
+// size. The default fits a chunk with its framing into a TCP segment.
+#ifndef PAGEBUILDER_TRANSMIT_SEGMENT_SIZE
+#if defined(TCP_MSS)
+#define PAGEBUILDER_TRANSMIT_SEGMENT_SIZE (TCP_MSS - 8)
+#elif defined(CONFIG_LWIP_TCP_MSS)
+#define PAGEBUILDER_TRANSMIT_SEGMENT_SIZE (CONFIG_LWIP_TCP_MSS - 8)
+#else
+#define PAGEBUILDER_TRANSMIT_SEGMENT_SIZE 1452
+#endif
+#endif
+
+// Heap space to be left for the network stack when the automatic
+// transfer encoding predicts the consumption of building the content.
+#ifndef PAGEBUILDER_HEAP_RESERVE
+#define PAGEBUILDER_HEAP_RESERVE          4096
+#endif
+
+// Name of the request argument that lists the tokens to be responded
+// with the JSON values by the page that exposes the tokens.
+#ifndef PAGEBUILDER_TOKENS_ARG
+#define PAGEBUILDER_TOKENS_ARG            "tokens"
+#endif
+
 // Delimiter character to appear the token in the page element
 // It must be given as a pair of OPEN and CLOSE.
 #ifndef PAGEBUILDER_TOKENDELIMITER_OPEN
@@ -132,6 +163,71 @@ using WebServer = ESP8266WebServer;
 #define PAGEELEMENT_TOKENIDENTIFIER_FILE  "file:"
 #endif
 
+// On ESP32, the mold written into the raw data partition is specified
+// with the partition label following this identifier. The partition is
+// mapped into the address space through the flash cache, and the mold
+// is terminated by a null or the erased area.
+#if defined(ARDUINO_ARCH_ESP32) && !defined(PAGEELEMENT_TOKENIDENTIFIER_PARTITION)
+#define PAGEELEMENT_TOKENIDENTIFIER_PARTITION "partition:"
+#endif
+
+// The host build reads the file: mold through the read-only mapping of
+// the file instead of the File API. The path of the mold is relative to
+// this directory. Defining PB_MOLD_NOMAP disables the mapping.
+#if !defined(ARDUINO) && !defined(PB_MOLD_NOMAP)
+#define PB_MOLD_MAPPED
+#ifndef PAGEELEMENT_MAPPED_ROOT
+#define PAGEELEMENT_MAPPED_ROOT           "."
+#endif
+#endif
+
+// The file: mold is read through a block buffer of this size, which
+// allows the lexer to scan the literal runs in bulk.
+#ifndef PAGEELEMENT_FILEBUFFER_SIZE
+#define PAGEELEMENT_FILEBUFFER_SIZE       128
+#endif
+
+// Maximum nesting depth of the token replacement. The replacement
+// string can contain tokens further, and the scanning position is
+// saved to the index stack with this depth in the PageElement.
+#ifndef PAGEELEMENT_INDEXSTACK_DEPTH
+#define PAGEELEMENT_INDEXSTACK_DEPTH      3
+#endif
+
+// Uncomment the following PB_MINIFY_MOLD to minify the heap and file:
+// molds at loading by default. The file: mold is minified into the file
+// with the suffix when it is first opened.
+// #define PB_MINIFY_MOLD
+#ifdef PB_MINIFY_MOLD
+#define PAGEELEMENT_MINIFY                true
+#else
+#define PAGEELEMENT_MINIFY                false
+#endif
+#ifndef PAGEELEMENT_MINIFIED_SUFFIX
+#define PAGEELEMENT_MINIFIED_SUFFIX       ".min"
+#endif
+
+// The file: mold is read from the precompiled mold with this suffix if
+// it exists, such as /index.htm.pbm produced by tools/pbmold.py.
+#ifndef PAGEELEMENT_PRECOMPILED_SUFFIX
+#define PAGEELEMENT_PRECOMPILED_SUFFIX    ".pbm"
+#endif
+#define PAGEELEMENT_PRECOMPILED_MAGIC     "PBM\x01"
+#define PAGEELEMENT_PRECOMPILED_TOKEN     0x80000000UL
+
+// A token whose handler ran past its timeout is served from the cached
+// value without calling the handler during this period in milliseconds.
+#ifndef PAGEELEMENT_TOKEN_BACKOFF
+#define PAGEELEMENT_TOKEN_BACKOFF         10000
+#endif
+
+// Uncomment the following PB_TOKEN_FUNCPTR to declare the token handler
+// as a plain function pointer instead of std::function. It reduces the
+// size of each token, but the handler cannot capture the variables.
+// #define PB_TOKEN_FUNCPTR
+
+class PagePrefetch;
+
 /**
  * Container for HTTP request parameters from the current client of the
  * ESP8266WebServer. It provides access methods equivalent to the HTTP
@@ -150,6 +246,7 @@ class PageArgument {
   size_t  size(void) const { return std::distance(_arguments.begin(), _arguments.end()); }
   bool  hasArg(const char* name) const { return hasArg(String(name)); }
   bool  hasArg(const String& name) const { return (arg(name) != _nullString); }
+  void  notReady(void) { _ready = false; }
   void  push(const String& name, const String& value);
 
  protected:
@@ -164,42 +261,100 @@ class PageArgument {
   _RequestArgumentLT _arguments;
 
  private:
+  friend class PageBuilder;
+  friend class PageElement;
+  friend class PagePrefetch;
+  friend class TokenSource;
+
   const _RequestArgumentST& _item(int i) const;
+  PagePrefetch* _prefetch = nullptr;  /**< Pre-evaluated token handlers */
+  std::vector<String>*  _memo = nullptr;  /**< Token values memoized by the measuring */
+  size_t  _replay = 0;                /**< Index of the memoized value to be replayed */
+  bool    _record = false;            /**< The token values are being memoized */
+  unsigned long _start = 0;           /**< Time when the rendering started */
+  unsigned long _budget = 0;          /**< Render budget of the page, 0 for unlimited */
+  bool    _ready = true;              /**< The token handler has the value ready */
+  bool    _format = false;            /**< The typed handler formats into _value, cleared when it did */
+  char    _value[PAGEFORMAT_VALUE_SIZE];  /**< The value of the typed handler being read */
   static const String  _nullString;
 };
 
 // Wrapper type definition of handler function to handle token.
+#ifdef PB_TOKEN_FUNCPTR
+typedef String (*HandleFuncT)(PageArgument&);
+#else
 typedef std::function<String(PageArgument&)>  HandleFuncT;
 
+// Return type of the token handler.
+template<typename F>
+using TokenValueT = decltype(std::declval<F&>()(std::declval<PageArgument&>()));
+
+// Enabled for the handler that returns the value to be formatted.
+template<typename F>
+using TypedHandlerT = typename std::enable_if<std::is_arithmetic<TokenValueT<F>>::value, int>::type;
+#endif
+
 /**
  * TokenSource manages the replacement source for PageElement.
  * The replacement source is defined as a token together with the
  * handler. It also supports proper reading depending on the distinction
  * between the type of PageElement and the storage where the token is
  * placed (it is a heap area or a text block that is a PROGMEM attribute).
+ * The escape mode of the token is applied to the replacement string
+ * during output. It is a plain record without the virtual table, and
+ * the attributes are packed into bytes.
  */
 class TokenSource {
  public:
   // Storage identifier of the token placed.
-  enum STORAGE_CLASS_t {
+  enum STORAGE_CLASS_t : uint8_t {
     HEAP,         /**< For const char */
     TEXT,         /**< For __FlashStringHelper */
     STRING,       /**< For String */
     FILE          /**< For File */
   };
 
-  TokenSource() : token(nullptr) {}
-  TokenSource(const char* token, HandleFuncT builder) : token(token), builder(builder), _storage(STORAGE_CLASS_t::HEAP) {}
-  TokenSource(const __FlashStringHelper* token, HandleFuncT builder) : token(reinterpret_cast<PGM_P>(token)), builder(builder), _storage(STORAGE_CLASS_t::TEXT) {}
-  virtual ~TokenSource() {}
+  TokenSource() : token(nullptr), builder(), escape(PageEscape::None), independent(false), _storage(STORAGE_CLASS_t::HEAP) {}
+  TokenSource(const char* token, HandleFuncT builder, PageEscape::Escape_t escape = PAGEBUILDER_TOKEN_ESCAPE) : token(token), builder(builder), escape(escape), independent(false), _storage(STORAGE_CLASS_t::HEAP) {}
+  TokenSource(const __FlashStringHelper* token, HandleFuncT builder, PageEscape::Escape_t escape = PAGEBUILDER_TOKEN_ESCAPE) : token(reinterpret_cast<PGM_P>(token)), builder(builder), escape(escape), independent(false), _storage(STORAGE_CLASS_t::TEXT) {}
+#ifndef PB_TOKEN_FUNCPTR
+  template<typename F, TypedHandlerT<F> = 0>
+  TokenSource(const char* token, F handler, const uint8_t precision = PAGEFORMAT_PRECISION) : TokenSource(token, HandleFuncT(), PageEscape::None) { _setFormat(handler, precision); }
+  template<typename F, TypedHandlerT<F> = 0>
+  TokenSource(const __FlashStringHelper* token, F handler, const uint8_t precision = PAGEFORMAT_PRECISION) : TokenSource(token, HandleFuncT(), PageEscape::None) { _setFormat(handler, precision); }
+#endif
   bool  match(const char* key) const {
     return !(_storage == HEAP ? strcmp(key, token) : strcmp_P(key, reinterpret_cast<const char*>(token)));
   }
+  String  name(void) const {
+    return _storage == HEAP ? String(token) : String(reinterpret_cast<const __FlashStringHelper*>(token));
+  }
 
   PGM_P         token;                /**< a token */
   HandleFuncT   builder;              /**< User defined handler to replace a token */
+  PageEscape::Escape_t  escape;       /**< Escape mode of the replacement string */
+  bool          independent;          /**< The handler can be evaluated in parallel */
 
  private:
+#ifndef PB_TOKEN_FUNCPTR
+  // The typed handler is wrapped into the builder that formats its
+  // value. The lexer has the value formatted into the arguments and
+  // reads it in place, and the other callers take it as the String.
+  template<typename F>
+  void  _setFormat(F handler, const uint8_t precision) {
+    builder = [handler, precision](PageArgument& args) {
+      if (args._format) {
+        args._format = false;
+        PageFormat::format(args._value, handler(args), precision);
+        return String();
+      }
+      char  buffer[PAGEFORMAT_VALUE_SIZE];
+      PageFormat::format(buffer, handler(args), precision);
+      return String(buffer);
+    };
+  }
+#endif
+
   STORAGE_CLASS_t  _storage;          /**< Explicit distinction of storage where token is placed */
 };
 
@@ -215,53 +370,145 @@ using TokenVT = std::vector<TokenSource>;
  * HTML and tokens that are replaced during processing.
  */
 class PageElement {
+  friend class PageBuilder;
+
  public:
   PageElement() {}
+  PageElement(const PageElement& element) : _reserveSize(element._reserveSize), _sources(element._sources), _deadlines(element._deadlines) { _copyMold(element); }
   explicit PageElement(const char* mold) : _sources(TokenVT()) { setMold(mold); }
   explicit PageElement(const __FlashStringHelper* mold) : _sources(TokenVT()) { setMold(mold); }
   PageElement(const char* mold, const TokenVT& sources) : _sources(sources) { setMold(mold); }
   PageElement(const __FlashStringHelper* mold, const TokenVT& sources) : _sources(sources) { setMold(mold); }
+  PageElement(const uint8_t* mold, const size_t length) : _sources(TokenVT()) { setMold(mold, length); }
+  PageElement(const uint8_t* mold, const size_t length, const TokenVT& sources) : _sources(sources) { setMold(mold, length); }
   ~PageElement() {}
-  void  addToken(const char* token, HandleFuncT handler);
-  void  addToken(const __FlashStringHelper* token, HandleFuncT handler);
+  PageElement&  operator=(const PageElement& element);
+  void  addToken(const char* token, HandleFuncT handler, PageEscape::Escape_t escape = PAGEBUILDER_TOKEN_ESCAPE);
+  void  addToken(const __FlashStringHelper* token, HandleFuncT handler, PageEscape::Escape_t escape = PAGEBUILDER_TOKEN_ESCAPE);
+#ifndef PB_TOKEN_FUNCPTR
+  template<typename F, TypedHandlerT<F> = 0>
+  void  addToken(const char* token, F handler, const uint8_t precision = PAGEFORMAT_PRECISION) { _setToken(TokenSource(token, handler, precision), token); }
+  template<typename F, TypedHandlerT<F> = 0>
+  void  addToken(const __FlashStringHelper* token, F handler, const uint8_t precision = PAGEFORMAT_PRECISION) { _setToken(TokenSource(token, handler, precision), String(token).c_str()); }
+#endif
   size_t  build(String& buffer);
   size_t  build(String& buffer, PageArgument& args);
   size_t  build(char* buffer, size_t length, PageArgument& args);
+  void  clearTokens(void) { _sources.clear(); }
   size_t  getApproxSize(void) const { return _approxSize; }
+  bool  hasToken(void) const { return !_sources.empty(); }
+  void  minify(const bool enable = true);
   PGM_P mold(void) const { return _mold; }
   void  reserve(const size_t reserveSize = 0) { _reserveSize = reserveSize; }
   void  rewind(void);
   void  setMold(const char* mold);
   void  setMold(const __FlashStringHelper* mold);
+  void  setMold(const uint8_t* mold, const size_t length);
+  void  setIndependent(const char* token, const bool independent = true);
+  void  setTimeout(const char* token, const unsigned long timeout, const char* fallback = nullptr);
+  TokenSource::STORAGE_CLASS_t  storage(void) const { return _storage; }
+  unsigned int  timeouts(const char* token = nullptr) const;
+  const TokenVT&  tokens(void) const { return _sources; }
 
  protected:
+  // The precompiled mold consists of the segment table of the literals
+  // and the interned tokens. The token segment is served to the lexer
+  // with its notation.
+  typedef struct {
+    std::vector<String> tokens;       /**< Interned token names */
+    std::unique_ptr<uint32_t[]> segments; /**< Segment table */
+    uint16_t  count;                  /**< Number of the segments */
+    uint16_t  next;                   /**< Index of the next segment */
+    uint32_t  remains;                /**< Unread length of the current literal segment */
+    bool      literal;                /**< The buffer holds the literal */
+  } _CompiledMoldST;
+
+  // The file: mold is read in blocks through this buffer. The mapped
+  // mold is scanned directly in the mapping as a single block, and the
+  // compressed mold is decompressed into the buffer.
+  typedef struct _FileBuffer {
+    ~_FileBuffer();
+    File    file;                     /**< Opened file: mold */
+    size_t  pos;                      /**< Read position in the block */
+    size_t  len;                      /**< Valid length of the block */
+    const char* data;                 /**< The block, the buffer or the mapping */
+    const void* map = nullptr;        /**< Mapped mold */
+    size_t  mapLength = 0;            /**< Length of the mapping */
+    uint32_t  mapHandle = 0;          /**< Handle of the flash mapping */
+    char    buffer[PAGEELEMENT_FILEBUFFER_SIZE];  /**< Block buffer */
+    std::unique_ptr<_CompiledMoldST>  compiled; /**< Precompiled mold */
+    std::unique_ptr<PageInflate>  inflate;  /**< Decompression of the compressed mold */
+  } _FileBufferST;
+
+  // Deadline of the token handler. The handler that is not ready, or
+  // runs out of the render budget, is replaced by the last value.
+  typedef struct {
+    String  token;                    /**< Token to be timed */
+    String  fallback;                 /**< Replacement until the value is cached */
+    String  cached;                   /**< Last value of the handler */
+    unsigned long timeout;            /**< Deadline of the handler in milliseconds */
+    unsigned long overrun;            /**< Time when the handler ran past the deadline */
+    unsigned int  timeouts;           /**< Number of the timeouts */
+    bool    valid;                    /**< The value has been cached */
+    bool    backoff;                  /**< The handler is suspended after the overrun */
+  } _DeadlineST;
+
   // Saves the lexical scan position when generating page elements from
   // the mold and tokens. _LexicalIndexST structure is pushed onto the
   // stack each time a token appearance during the mold scanning.
+  // Only the mold can be a file, so the file is held by the element.
   typedef struct {
     PGM_P _p;                         /**< Position of the mold or token lexical during scanning */
     unsigned int  _s;                 /**< Read offset in the string replaced from the token */
     String  _fillin;                  /**< String with a token replaced */
-    std::shared_ptr<File> _file;      /**< File for file: mold */
     TokenSource::STORAGE_CLASS_t  _storage; /**< Distinct class of storage to be scanned */
   } _LexicalIndexST;
 
   char    _contextRead(PageArgument& args); /**< Common lexical reader */
+  void    _copyMold(const PageElement& element);  /**< Copy the mold with the minified cache */
   String  _extractToken(void);        /**< Read as context while replacing the tokens */
+  String  _call(const TokenSource& source, PageArgument& args, const unsigned long timeout = ULONG_MAX); /**< Call the token handler or take its pre-evaluation */
+  String  _evaluate(const TokenSource& source, PageArgument& args); /**< Evaluate the token or replay its memoized value */
+  String  _invoke(const TokenSource& source, PageArgument& args); /**< Call the token handler within the deadline */
+  size_t  _literal(PGM_P& run, const size_t limit = SIZE_MAX); /**< Find the literal run at the current position */
+  size_t  _literalRead(char* buffer, size_t length);  /**< Read the literal run in bulk */
+  void    _literalSkip(size_t len);   /**< Consume the literal run */
+  size_t  _prefix(char* buffer, size_t length); /**< Read the literal prefix up to the first token */
+  bool    _fillCompiled(void);        /**< Refill the block buffer with the next segment */
+  bool    _fillFile(void);            /**< Refill the block buffer of the file: mold */
+  void    _loadFile(void);            /**< Prepare the file: mold at the first opening */
+  bool    _minifyFile(void);          /**< Minify the file: mold into the cache file */
+  bool    _minifyHeap(void);          /**< Minify the heap mold into the cache */
+  bool    _openCompiled(void);        /**< Read the tables of the precompiled mold */
+  bool    _mapFile(void);             /**< Map the file: mold into the memory */
+  size_t  _measure(PageArgument& args); /**< Measure the length of the content */
+  bool    _openFile(void);            /**< Open the file: mold */
+  void    _setToken(const TokenSource& source, const char* key);  /**< Register the token source */
   char    _read(void);                /**< Common lexical reader */
 
   char    _sub_c;                     /**< Subsequent characters at a token delimiter appearance */
+  char    _back_c = '\0';             /**< A character pushed back by the building that failed */
   size_t  _reserveSize = 0;           /**< Size when reserving read buffer as context */
-  size_t  _approxSize;                /**< Approximate length of context without tokens */
+  size_t  _approxSize = 0;            /**< Approximate length of context without tokens */
+  size_t  _moldLength = 0;            /**< Length of the compressed mold */
 
-  PGM_P   _mold;                      /**< mold */
+  PGM_P   _mold = nullptr;            /**< mold */
   TokenVT _sources;                   /**< Array of tokens */
+  std::forward_list<_DeadlineST> _deadlines;  /**< Deadlines of the token handlers */
  
  private:
   TokenSource::STORAGE_CLASS_t  _storage;     /**< Storage class of the mold */
-  _LexicalIndexST               _raw;         /**< Position of lexical currently being scanned */
-  std::stack<_LexicalIndexST>   _indexStack;  /**< Stack for the mold scanning position save */
   bool    _eoe;                       /**< The element has been read */
+  bool    _minify = PAGEELEMENT_MINIFY; /**< Minify the mold at loading */
+  bool    _loadPending = false;       /**< The file: mold has not been opened */
+  bool    _partition = false;         /**< The mold is in the flash partition */
+  bool    _compressed = false;        /**< The mold is compressed in the PROGMEM */
+  bool    _compiled = false;          /**< The file: mold is precompiled */
+  uint8_t _depth = 0;                 /**< Depth of the index stack */
+  _LexicalIndexST _raw;               /**< Position of lexical currently being scanned */
+  _LexicalIndexST _indexStack[PAGEELEMENT_INDEXSTACK_DEPTH];  /**< Stack for the mold scanning position save */
+  std::unique_ptr<_FileBufferST>  _file;  /**< Block buffer of the opened file: mold */
+  std::unique_ptr<char[]> _cache;     /**< Minified mold, or the path of the minified or precompiled file: mold */
 };
 
 // The type of user-owned function for preparing the handling of current URI.
@@ -302,7 +549,20 @@ namespace PageBuilderUtil {
     const String&,
     String
   >::type;
-};
+
+  // The largest block of the heap that can be allocated at once.
+  inline size_t maxFreeBlock(void) {
+#if defined(ARDUINO_ARCH_ESP8266)
+    return ESP.getMaxFreeBlockSize();
+#elif defined(ARDUINO_ARCH_ESP32)
+    return ESP.getMaxAllocHeap();
+#endif
+  }
+}
+
+class PageAdmission;
+class PageOutput;
+class PageSession;
 
 /**
  * HTML assembly aid.
@@ -310,16 +570,28 @@ namespace PageBuilderUtil {
  * response handler for url access for the WebServer class.
  */
 class PageBuilder : public RequestHandler {
+  friend class PageEvents;
+  friend class PageRouter;
+
  public:
   // Identifier of transfer coding method with sending HTML
   enum TransferEncoding_t {
-    Auto,         /**< Short HTML is sent once, otherwise chunked */
+    Auto,         /**< Selected by the content size and the free heap */
     ByteStream,   /**< Chunked but not split into each PageElement segment */
     Chunked,      /**< Chunked with each PageElement segment */
     Compress,     /**< Not suppoted */
     Deflate,      /**< Not suppoted */
     Gzip,         /**< Not suppoted */
-    Identity      /**< Not suppoted */
+    Identity      /**< Whole content is sent at once with the Content-Length */
+  };
+
+  // Cache policy of the response
+  enum CachePolicy_t : uint8_t {
+    NoControl,    /**< No cache control header */
+    NoCache,      /**< Not to be cached */
+    Private,      /**< Cached by the browser only with max-age */
+    Public,       /**< Cached by any cache with max-age */
+    Immutable     /**< Cached with max-age and not revalidated */
   };
 
   // The type of user-owned function for uploading.
@@ -338,13 +610,25 @@ class PageBuilder : public RequestHandler {
   virtual bool  canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
   virtual bool  canUpload(PageBuilderUtil::URI_TYPE_SIGNATURE uri) override;
   void  clearElements(void) { _elements.clear(); }
+  static void collectHeaders(WebServer& server, const char* headerKeys[] = nullptr, const size_t headerKeysCount = 0);
   void  enableCORS(const bool CORS) { _cors = CORS; }
   void  exitCanHandle(PrepareFuncT prepareFunc) { _canHandle = prepareFunc; }
+  void  exposeTokens(const bool expose = true) { _exposeTokens = expose; }
   bool  handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
   void  insert(WebServer& server) { server.addHandler(this); }
   virtual void  onUpload(UploadFuncT uploadFunc) { _upload = uploadFunc; }
+  void  preEvaluate(const bool enable = true) { _preEvaluate = enable; }
   void  reserve(const size_t reserveSize) { _reserveSize = reserveSize; }
-  void  setNoCache(const bool noCache) { _noCache = noCache; }
+  void  setAdmission(PageAdmission& admission) { _admission = &admission; }
+  void  setFlush(const bool flush) { _flush = flush; }
+  void  setCache(const CachePolicy_t policy, const unsigned long maxAge = 0);
+  void  setEarlyFlush(const bool early = true) { _earlyFlush = early; }
+  void  setExactLength(const bool exact) { _exactLength = exact; }
+  void  setNoCache(const bool noCache) { setCache(noCache ? NoCache : NoControl); }
+  void  setPipeline(const bool pipeline) { _pipeline = pipeline; }
+  void  setSession(PageSession& session) { _session = &session; }
+  void  setStaticFile(const bool enable = true, const char* mime = nullptr) { _staticFile = enable; _mime = mime; }
+  void  setRenderBudget(const unsigned long budget) { _budget = budget; }
   void  setUri(const char* uri) { _uri = String(uri); }
   void  transferEncoding(const TransferEncoding_t encoding) { _enc = encoding; }
   virtual void  upload(WebServer& server, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri, HTTPUpload& upload) override;
@@ -358,20 +642,44 @@ class PageBuilder : public RequestHandler {
   bool          _cors;                /**< Allow cross-origin */
 
  private:
+  bool    _authenticate(WebServer& server, bool& issue); /**< Certify the request */
+  void    _composeHeaders(void);      /**< Compose the cache control header block */
   size_t  _getApproxSize(void) const; /**< Calculate an approximate generating size o the HTML */
-  void    _handle(int code, WebServer& server); /**< URL request handler */
-
-  bool          _noCache;             /**< Need to send the no-cache header */
+  void    _handle(int code, WebServer& server, const PageArgument* params = nullptr, const bool issue = false); /**< URL request handler with the admission */
+  void    _predictSize(size_t& wholeSize, size_t& elementSize) const; /**< Predict the heap consumption of the content */
+  void    _render(int code, WebServer& server, const PageArgument* params, const TransferEncoding_t enc); /**< Build and send the content */
+  bool    _respond(WebServer& server, const PageArgument* params = nullptr);  /**< Respond with the certification */
+  TransferEncoding_t  _selectEncoding(const size_t wholeSize, const size_t elementSize) const; /**< Select the transfer encoding by the heap */
+  bool    _sendCompressed(WebServer& server); /**< Send the token-free compressed mold as it is */
+  bool    _sendFile(WebServer& server);   /**< Send the token-free file: mold with the range */
+  size_t  _sendPrefix(int code, WebServer& server, PageOutput& output); /**< Send the headers and the literal prefix */
+  bool    _sendStream(int code, WebServer& server, PageOutput& output, PageElement& element, PageArgument& args, bool& firstOrder); /**< Stream the remains of the element */
+  void    _sendTokens(int code, WebServer& server, PageArgument& args); /**< Send the token values as JSON */
+
+  CachePolicy_t _cachePolicy;         /**< Cache policy of the response */
   bool          _cancel;              /**< Cancel to send content */
+  bool          _flush = false;       /**< Flush the client at each chunk */
+  bool          _exposeTokens = false;  /**< Respond to the tokens argument with JSON */
+  bool          _preEvaluate = false; /**< Pre-evaluate the independent token handlers */
+  bool          _pipeline = false;    /**< Transmit the segment while building the next */
+  bool          _exactLength = false; /**< Stream with the Content-Length measured in advance */
+  bool          _earlyFlush = false;  /**< Send the literal prefix before the token handlers */
+  bool          _staticFile = false;  /**< Send the token-free file: mold as it is */
+  const char*   _mime = nullptr;      /**< Content-Type of the static file, by the extension if nullptr */
   TransferEncoding_t  _enc;           /**< Transfer encoding for this sending */
   HTTPAuthMethod  _auth;              /**< HTTP authentication scheme */
   size_t        _reserveSize = 0;     /**< Buffer reservation size */
+  unsigned long _maxAge = 0;          /**< max-age of the cache policy in seconds */
+  unsigned long _budget = 0;          /**< Render budget of the page in milliseconds */
   WebServer*    _server = nullptr;    /**< An instance of the WebServer that owns this request handler */
+  PageAdmission*  _admission = nullptr; /**< Admission control of the page */
+  PageSession*  _session = nullptr;   /**< Session store of the authentication */
   PrepareFuncT  _canHandle;           /**< An exit of canHandle invoke */
   String        _username;            /**< Username for an auth */
   String        _password;            /**< Password for an auth */
   String        _realm;               /**< REALM for the current auth */
   String        _fails;               /**< Message for fails with authentication */
+  String        _cacheHeader;         /**< Precomposed value of the Cache-Control header */
 
   // A set of fixed directives just for sending No-cache headers
   typedef struct {
@@ -379,6 +687,9 @@ class PageBuilder : public RequestHandler {
     PGM_P value;
   } _httpHeaderConstST;
   static const _httpHeaderConstST  _headersNocache[] PROGMEM;
+
+  // Request headers that PageBuilder refers to
+  static const char* const  _requestHeaders[];
 };
 
 #endif  // !_PAGEBUILDER_H_
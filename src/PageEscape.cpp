@@ -0,0 +1,224 @@
+/**
+ *  An implementation of the escaping kernels of PageEscape class.
+ *  @file PageEscape.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include <utility>
+#include "PageEscape.h"
+#include "PageScan.h"
+
+namespace {
+  // Bitmap of the unreserved characters of RFC 3986, A-Z a-z 0-9 -._~
+  const uint8_t _unreserved[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0xff, 0x03,
+    0xfe, 0xff, 0xff, 0x87, 0xfe, 0xff, 0xff, 0x47
+  };
+
+  const char  _hexDigits[] = "0123456789ABCDEF";
+}
+
+/**
+ * Escape the string in place. If the string does not contain any
+ * character to be escaped, it remains untouched without allocation.
+ * @param   str   The string to be escaped.
+ * @param   mode  Escape mode.
+ * @return  false if the escaped string could not be allocated.
+ */
+bool PageEscape::escape(String& str, const Escape_t mode) {
+  if (mode == None)
+    return true;
+  const size_t  len = str.length();
+  const size_t  pos = scan(str.c_str(), len, mode);
+  if (pos >= len)
+    return true;
+
+  String  escaped;
+  if (!escaped.reserve(len + (len >> 3) + 8))
+    return false;
+  escaped.concat(str.c_str(), pos);
+  if (!escape(escaped, str.c_str() + pos, len - pos, mode))
+    return false;
+  str = std::move(escaped);
+  return true;
+}
+
+/**
+ * Append the escaped source to the destination. The clean runs are
+ * appended at once.
+ * @param   dst   Destination string.
+ * @param   src   Source characters.
+ * @param   len   Length of the source.
+ * @param   mode  Escape mode.
+ * @return  false if the destination could not be expanded.
+ */
+bool PageEscape::escape(String& dst, const char* src, const size_t len, const Escape_t mode) {
+  size_t  pos = 0;
+
+  while (pos < len) {
+    const size_t  run = scan(src + pos, len - pos, mode);
+    if (run) {
+      if (!dst.concat(src + pos, run))
+        return false;
+      pos += run;
+    }
+    if (pos < len) {
+      char  rep[8];
+      const size_t  repLen = _replace(rep, static_cast<uint8_t>(src[pos++]), mode);
+      if (!dst.concat(rep, repLen))
+        return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Find the first character that needs to be escaped.
+ * @param   src   Source characters.
+ * @param   len   Length of the source.
+ * @param   mode  Escape mode.
+ * @return  Offset of the first character to be escaped, len if the
+ * source is clean.
+ */
+size_t PageEscape::scan(const char* src, const size_t len, const Escape_t mode) {
+  using namespace PageBuilderUtil::SWAR;
+  size_t  pos = 0;
+
+  if (mode == None)
+    return len;
+
+  // The unreserved set of the URL does not suit to SWAR tests,
+  // it is looked up a bitmap for each byte.
+  if (mode != URL) {
+    const size_t  head = misalign(src);
+    for (; pos < head && pos < len; pos++)
+      if (_special(static_cast<uint8_t>(src[pos]), mode))
+        return pos;
+
+    while (pos + sizeof(word_t) <= len) {
+      const word_t  w = load(src + pos);
+      word_t  mask;
+      if (mode == JSON)
+        mask = hasByte(w, '"') | hasByte(w, '\\') | hasByte(w, '<') | hasLess(w, 0x20);
+      else {
+        mask = hasByte(w, '&') | hasByte(w, '<') | hasByte(w, '>') | hasByte(w, '"') | hasByte(w, '\'');
+        if (mode == Attribute)
+          mask |= hasByte(w, '`') | hasByte(w, '=') | hasLess(w, 0x21);
+      }
+      if (mask)
+        return pos + first(mask);
+      pos += sizeof(word_t);
+    }
+  }
+
+  for (; pos < len; pos++)
+    if (_special(static_cast<uint8_t>(src[pos]), mode))
+      break;
+  return pos;
+}
+
+/**
+ * Determines whether the character needs to be escaped.
+ * @param   c     A character.
+ * @param   mode  Escape mode.
+ * @return  true  The character needs to be escaped.
+ */
+bool PageEscape::_special(const uint8_t c, const Escape_t mode) {
+  switch (mode) {
+  case HTML:
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+  case Attribute:
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'' || c == '`' || c == '=' || c <= 0x20;
+  case JSON:
+    return c == '"' || c == '\\' || c == '<' || c < 0x20;
+  case URL:
+    return c >= 0x80 || !(_unreserved[c >> 3] & (1 << (c & 7)));
+  default:
+    return false;
+  }
+}
+
+/**
+ * Generate the escape sequence of the character.
+ * @param   rep   Buffer to store the sequence, at least 8 bytes.
+ * @param   c     A character to be escaped.
+ * @param   mode  Escape mode.
+ * @return  Length of the sequence.
+ */
+size_t PageEscape::_replace(char* rep, const uint8_t c, const Escape_t mode) {
+  PGM_P entity = nullptr;
+
+  if (mode == HTML || mode == Attribute) {
+    switch (c) {
+    case '&':
+      entity = PSTR("&amp;");
+      break;
+    case '<':
+      entity = PSTR("&lt;");
+      break;
+    case '>':
+      entity = PSTR("&gt;");
+      break;
+    case '"':
+      entity = PSTR("&quot;");
+      break;
+    case '\'':
+      entity = PSTR("&#39;");
+      break;
+    default:
+      // Numeric character reference for the remains of the attribute.
+      memcpy(rep, "&#x", 3);
+      rep[3] = _hexDigits[c >> 4];
+      rep[4] = _hexDigits[c & 0xf];
+      rep[5] = ';';
+      return 6;
+    }
+  }
+  else if (mode == JSON) {
+    rep[0] = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+      rep[1] = c;
+      return 2;
+    case '\b':
+      rep[1] = 'b';
+      return 2;
+    case '\f':
+      rep[1] = 'f';
+      return 2;
+    case '\n':
+      rep[1] = 'n';
+      return 2;
+    case '\r':
+      rep[1] = 'r';
+      return 2;
+    case '\t':
+      rep[1] = 't';
+      return 2;
+    default:
+      // Control characters and '<' that prevents closing a script.
+      memcpy(rep + 1, "u00", 3);
+      rep[4] = _hexDigits[c >> 4];
+      rep[5] = _hexDigits[c & 0xf];
+      return 6;
+    }
+  }
+  else if (mode == URL) {
+    rep[0] = '%';
+    rep[1] = _hexDigits[c >> 4];
+    rep[2] = _hexDigits[c & 0xf];
+    return 3;
+  }
+  else {
+    rep[0] = static_cast<char>(c);
+    return 1;
+  }
+
+  const size_t  len = strlen_P(entity);
+  memcpy_P(rep, entity, len);
+  return len;
+}
@@ -0,0 +1,48 @@
+/**
+ *  Declaration of PageEscape class.
+ *  @file PageEscape.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEESCAPE_H_
+#define _PAGEESCAPE_H_
+
+#include <Arduino.h>
+
+/**
+ * Escaping kernels applied to the token replacement string during the
+ * output. The string is scanned a word at a time and the runs that do
+ * not need escaping are copied in bulk, so a clean string costs only a
+ * single pass without any allocation.
+ */
+class PageEscape {
+ public:
+  // Escape mode applied to the token replacement string.
+  enum Escape_t : uint8_t {
+    None,         /**< Output as it is */
+    HTML,         /**< HTML text content, escapes &<>"' */
+    Attribute,    /**< HTML attribute value, also safe for an unquoted value */
+    JSON,         /**< Inside the JSON string literal */
+    URL           /**< URL component, percent-encoding except unreserved */
+  };
+
+  static bool   escape(String& str, const Escape_t mode);
+  static bool   escape(String& dst, const char* src, const size_t len, const Escape_t mode);
+  static size_t scan(const char* src, const size_t len, const Escape_t mode);
+
+ private:
+  static bool   _special(const uint8_t c, const Escape_t mode);
+  static size_t _replace(char* rep, const uint8_t c, const Escape_t mode);
+};
+
+// The escape mode that tokens carry if it is not specified at the token
+// registration. Tokens are usually replaced with HTML fragments, so the
+// default is no escaping.
+#ifndef PAGEBUILDER_TOKEN_ESCAPE
+#define PAGEBUILDER_TOKEN_ESCAPE          PageEscape::None
+#endif
+
+#endif // !_PAGEESCAPE_H_
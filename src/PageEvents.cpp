@@ -0,0 +1,253 @@
+/**
+ *  An implementation of the Server-Sent Events stream of PageEvents class.
+ *  @file PageEvents.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageEvents.h"
+
+namespace {
+  // The client script that patches the token values into the DOM.
+  // The URI of the event stream follows it as an argument.
+  const char  _script[] PROGMEM = "(function(u){"
+    "var s=new EventSource(u);"
+    "s.addEventListener('tokens',function(e){"
+      "var d=JSON.parse(e.data);"
+      "for(var k in d){"
+        "var n=document.querySelectorAll('[" PAGEEVENTS_TOKEN_ATTRIBUTE "=\"'+k+'\"]');"
+        "for(var i=0;i<n.length;i++)n[i].innerHTML=d[k];"
+      "}"
+    "});"
+  "})";
+}
+
+/**
+ * Construct the event stream for the page.
+ * @param   uri       URI of the event stream.
+ * @param   page      Page that owns the tokens to be pushed.
+ * @param   interval  Evaluation interval in milliseconds, 0 is on demand.
+ */
+PageEvents::PageEvents(const char* uri, PageBuilder& page, const unsigned long interval)
+: _uri(String(uri))
+, _page(page)
+, _interval(interval)
+{}
+
+/**
+ * The event stream is subscribed with GET.
+ * @param   requestMethod   HTTP method of the current request.
+ * @param   requestUri      Requested URI
+ * @return  true  The request subscribes this stream.
+ */
+bool PageEvents::canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  return requestMethod == HTTP_GET && requestUri == _uri;
+}
+
+/**
+ * Accept the subscription. The response header of the event stream is
+ * sent directly to the client, and the connection is held open after
+ * the WebServer has finished with the request. The current values of
+ * all tokens are sent to the new client at first.
+ * @param  server         Reference of the calling WebServer instance
+ * @param  requestMethod  The HTTP request that made this call
+ * @param  requestUri     The URI for this request
+ * @return true   handled
+ */
+bool PageEvents::handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  if (!canHandle(requestMethod, requestUri))
+    return false;
+  // The event stream writes its own header, and the session is not
+  // issued with it.
+  bool  issue;
+  if (!_page._authenticate(server, issue))
+    return true;
+
+  if (_clients.size() >= PAGEEVENTS_MAX_CLIENTS) {
+    PB_DBG("Events %s subscription closed\n", _uri.c_str());
+    _clients.front().stop();
+    _clients.erase(_clients.begin());
+  }
+
+  WiFiClient  client = server.client();
+  client.setNoDelay(true);
+  String  header;
+  header.reserve(160);
+  header = F("HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n");
+  if (_page._cors)
+    header += F("Access-Control-Allow-Origin: *\r\n");
+  header += F("\r\nretry: ");
+  header += String(PAGEEVENTS_RETRY);
+  header += F("\n\n");
+
+  // The values are remembered at the subscription, and the ones that
+  // have changed since the last push are also sent to the others.
+  PageArgument  args;
+  for (uint8_t i = 0; i < server.args(); i++)
+    args.push(server.argName(i), server.arg(i));
+  String  changes;
+  String  data;
+  if (_evaluate(changes, args, &data) && _clients.size())
+    _broadcast(changes);
+  if (_send(client, header) && (!data.length() || _send(client, data))) {
+    _clients.push_back(client);
+    _lastSent = millis();
+    PB_DBG("Events %s subscribed, %u clients\n", _uri.c_str(), _clients.size());
+  }
+  return true;
+}
+
+/**
+ * Evaluate the tokens at the interval and keep the idle connections.
+ * It should be called from the loop function.
+ */
+void PageEvents::handleClient(void) {
+  const unsigned long now = millis();
+
+  if (_interval && now - _lastUpdate >= _interval)
+    update();
+  else if (_clients.size() && now - _lastSent >= PAGEEVENTS_KEEPALIVE)
+    _broadcast(String(F(":\n\n")));
+}
+
+/**
+ * Returns the client script to be placed in the page.
+ * @return  The script that subscribes to this event stream.
+ */
+String PageEvents::script(void) const {
+  String  js(FPSTR(_script));
+  js += F("('");
+  js += _uri;
+  js += F("');");
+  return js;
+}
+
+/**
+ * Evaluate the tokens now, and push the changed values to the clients.
+ * The disconnected clients are dropped first, and the tokens are not
+ * evaluated if nobody subscribes.
+ * @return  Number of the changed tokens.
+ */
+size_t PageEvents::update(void) {
+  _lastUpdate = millis();
+  auto  client = _clients.begin();
+  while (client != _clients.end()) {
+    if (client->connected())
+      ++client;
+    else {
+      PB_DBG("Events %s client left\n", _uri.c_str());
+      client->stop();
+      client = _clients.erase(client);
+    }
+  }
+  if (!_clients.size())
+    return 0;
+
+  PageArgument  args;
+  String  data;
+  const size_t  changes = _evaluate(data, args);
+  if (changes)
+    _broadcast(data);
+  return changes;
+}
+
+/**
+ * Evaluate the tokens of the page and make an event of the changed
+ * values, which are remembered as sent. The same name of the token in
+ * the elements is evaluated once.
+ * @param   data    Returns the event, empty if no value has changed.
+ * @param   args    Arguments to be passed to the token handlers.
+ * @param   whole   Returns the event of all the values if specified.
+ * @return  Number of the changed values.
+ */
+size_t PageEvents::_evaluate(String& data, PageArgument& args, String* whole) {
+  std::vector<bool> evaluated(_values.size(), false);
+  size_t  count = 0;
+  size_t  total = 0;
+
+  data = String();
+  if (whole)
+    *whole = String();
+  for (auto& element : _page._elements) {
+    for (const TokenSource& source : element.get().tokens()) {
+      if (!source.builder)
+        continue;
+      const String  name = source.name();
+      size_t  i = 0;
+      while (i < _values.size() && _values[i].name != name)
+        i++;
+      if (i < evaluated.size() && evaluated[i])
+        continue;
+      if (i == _values.size()) {
+        _values.push_back({ name, String() });
+        evaluated.push_back(false);
+      }
+      evaluated[i] = true;
+
+      String  value = source.builder(args);
+      PageEscape::escape(value, source.escape);
+      if (whole)
+        _append(*whole, total++, name, value);
+      if (value == _values[i].value)
+        continue;
+      _values[i].value = value;
+      _append(data, count++, name, value);
+    }
+  }
+  if (count)
+    data += F("}\n\n");
+  if (whole && total)
+    *whole += F("}\n\n");
+  return count;
+}
+
+/**
+ * Append the value of the token to the event.
+ * @param   data    The event being made.
+ * @param   index   Number of the values already in the event.
+ * @param   name    Token name.
+ * @param   value   Escaped replacement string.
+ */
+void PageEvents::_append(String& data, const size_t index, const String& name, const String& value) {
+  data += index ? F(",\"") : F("event: tokens\ndata: {\"");
+  PageEscape::escape(data, name.c_str(), name.length(), PageEscape::JSON);
+  data += F("\":\"");
+  PageEscape::escape(data, value.c_str(), value.length(), PageEscape::JSON);
+  data += '"';
+}
+
+/**
+ * Send the data to all clients, and the disconnected clients are
+ * removed.
+ * @param   data  The data to be sent.
+ */
+void PageEvents::_broadcast(const String& data) {
+  auto  client = _clients.begin();
+  while (client != _clients.end()) {
+    if (_send(*client, data))
+      ++client;
+    else {
+      PB_DBG("Events %s client left\n", _uri.c_str());
+      client->stop();
+      client = _clients.erase(client);
+    }
+  }
+  _lastSent = millis();
+}
+
+/**
+ * Send the data to the client.
+ * @param   client  The client.
+ * @param   data    The data to be sent.
+ * @return  false if the client has been disconnected.
+ */
+bool PageEvents::_send(WiFiClient& client, const String& data) {
+  if (!client.connected())
+    return false;
+  return client.write(reinterpret_cast<const uint8_t*>(data.c_str()), data.length()) == data.length();
+}
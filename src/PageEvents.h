@@ -0,0 +1,91 @@
+/**
+ *  Declaration of PageEvents class.
+ *  @file PageEvents.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEEVENTS_H_
+#define _PAGEEVENTS_H_
+
+#include <vector>
+#include "PageBuilder.h"
+
+// Interval in milliseconds to evaluate the tokens of the page.
+// 0 evaluates the tokens only on demand with PageEvents::update.
+#ifndef PAGEEVENTS_INTERVAL
+#define PAGEEVENTS_INTERVAL               2000
+#endif
+
+// Interval in milliseconds to send a comment line that keeps the idle
+// connection and detects the disconnected clients.
+#ifndef PAGEEVENTS_KEEPALIVE
+#define PAGEEVENTS_KEEPALIVE              15000
+#endif
+
+// Maximum number of clients subscribing to the event stream. When it
+// is exceeded, the oldest subscription is closed.
+#ifndef PAGEEVENTS_MAX_CLIENTS
+#define PAGEEVENTS_MAX_CLIENTS            4
+#endif
+
+// Reconnection time in milliseconds that the client waits for when the
+// stream is disconnected.
+#ifndef PAGEEVENTS_RETRY
+#define PAGEEVENTS_RETRY                  3000
+#endif
+
+// The attribute of the HTML element whose content is replaced with the
+// token value by the client script.
+#ifndef PAGEEVENTS_TOKEN_ATTRIBUTE
+#define PAGEEVENTS_TOKEN_ATTRIBUTE        "data-pb-token"
+#endif
+
+/**
+ * A RequestHandler for the Server-Sent Events stream that pushes the
+ * token values of the page. The subscribing connection is held open,
+ * the token handlers of the page are evaluated at the interval or on
+ * demand, and only the tokens whose values changed are sent as a JSON
+ * object with the "tokens" event. The client script replaces the
+ * content of the HTML element that has the token attribute.
+ */
+class PageEvents : public RequestHandler {
+ public:
+  PageEvents(const char* uri, PageBuilder& page, const unsigned long interval = PAGEEVENTS_INTERVAL);
+  ~PageEvents() {}
+  virtual bool  canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  size_t  clients(void) const { return _clients.size(); }
+  bool  handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  void  handleClient(void);
+  void  insert(WebServer& server) { server.addHandler(this); }
+  String  script(void) const;
+  void  setInterval(const unsigned long interval) { _interval = interval; }
+  size_t  update(void);
+  const char* uri(void) const { return _uri.c_str(); }
+
+ protected:
+  // The last value of the token sent to the clients.
+  typedef struct {
+    String  name;                     /**< Token name */
+    String  value;                    /**< Escaped replacement string */
+  } _TokenValueST;
+
+  static void _append(String& data, const size_t index, const String& name, const String& value);
+  size_t  _evaluate(String& data, PageArgument& args, String* whole = nullptr);
+  void    _broadcast(const String& data);
+  bool    _send(WiFiClient& client, const String& data);
+
+  String        _uri;                 /**< URI of the event stream */
+  PageBuilder&  _page;                /**< Page that owns the tokens */
+  unsigned long _interval;            /**< Evaluation interval */
+
+ private:
+  std::vector<WiFiClient>     _clients; /**< Subscribing clients */
+  std::vector<_TokenValueST>  _values;  /**< Token values sent last */
+  unsigned long _lastUpdate = 0;      /**< Time of the last evaluation */
+  unsigned long _lastSent = 0;        /**< Time of the last transmission */
+};
+
+#endif // !_PAGEEVENTS_H_
@@ -0,0 +1,128 @@
+/**
+ *  An implementation of the formatting kernels of PageFormat class.
+ *  @file PageFormat.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include <math.h>
+#include "PageFormat.h"
+
+namespace {
+  const uint32_t  _pow10[PAGEFORMAT_PRECISION_MAX + 1] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+  };
+
+  // Writes the digits backward from the end, two digits at a time.
+  template<typename U>
+  char* _digits(char* end, U v) {
+    while (v >= 100) {
+      const unsigned int  r = static_cast<unsigned int>(v % 100);
+      v /= 100;
+      *--end = '0' + r % 10;
+      *--end = '0' + r / 10;
+    }
+    if (v >= 10) {
+      *--end = '0' + static_cast<unsigned int>(v) % 10;
+      *--end = '0' + static_cast<unsigned int>(v) / 10;
+    }
+    else
+      *--end = '0' + static_cast<unsigned int>(v);
+    return end;
+  }
+}
+
+/**
+ * Format the boolean value.
+ * @param   buffer    The buffer of PAGEFORMAT_VALUE_SIZE.
+ * @param   value     The value.
+ * @param   precision Not used.
+ * @return  Length of the formatted value.
+ */
+size_t PageFormat::format(char* buffer, const bool value, const uint8_t precision) {
+  (void)(precision);
+  strcpy(buffer, value ? "true" : "false");
+  return value ? 4 : 5;
+}
+
+/**
+ * Format the floating value with the fixed digits after the decimal
+ * point. The value is rounded half up into the integer scaled by the
+ * precision, the same as the String. The value whose scaled integer
+ * exceeds the exact range of the double is formatted by the printf, in
+ * the exponential notation if it does not fit the buffer.
+ * @param   buffer    The buffer of PAGEFORMAT_VALUE_SIZE.
+ * @param   value     The value.
+ * @param   precision Digits after the decimal point.
+ * @return  Length of the formatted value.
+ */
+size_t PageFormat::_float(char* buffer, const double value, uint8_t precision) {
+  if (isnan(value)) {
+    strcpy(buffer, "nan");
+    return 3;
+  }
+  if (isinf(value)) {
+    strcpy(buffer, value < 0 ? "-inf" : "inf");
+    return value < 0 ? 4 : 3;
+  }
+  if (precision > PAGEFORMAT_PRECISION_MAX)
+    precision = PAGEFORMAT_PRECISION_MAX;
+  const uint32_t  scale = _pow10[precision];
+  const double    magnitude = fabs(value);
+  if (magnitude >= 4503599627370496.0 / scale) {
+    const int len = snprintf(buffer, PAGEFORMAT_VALUE_SIZE, "%.*f", precision, value);
+    if (len < PAGEFORMAT_VALUE_SIZE)
+      return len;
+    return snprintf(buffer, PAGEFORMAT_VALUE_SIZE, "%.*e", precision, value);
+  }
+
+  const uint64_t  scaled = static_cast<uint64_t>(magnitude * scale + 0.5);
+  uint32_t  fraction = static_cast<uint32_t>(scaled % scale);
+  char* p = buffer;
+  if (value < 0 && scaled)
+    *p++ = '-';
+  p += _unsigned(p, scaled / scale);
+  if (precision) {
+    *p++ = '.';
+    for (uint8_t i = precision; i > 0; i--) {
+      p[i - 1] = '0' + fraction % 10;
+      fraction /= 10;
+    }
+    p += precision;
+  }
+  *p = '\0';
+  return p - buffer;
+}
+
+/**
+ * Format the signed integer.
+ * @param   buffer  The buffer of PAGEFORMAT_VALUE_SIZE.
+ * @param   value   The value.
+ * @return  Length of the formatted value.
+ */
+size_t PageFormat::_signed(char* buffer, const long long value) {
+  if (value >= 0)
+    return _unsigned(buffer, value);
+  *buffer = '-';
+  return _unsigned(buffer + 1, 0ULL - static_cast<unsigned long long>(value)) + 1;
+}
+
+/**
+ * Format the unsigned integer. The value within 32 bits is divided
+ * without the 64-bit arithmetic.
+ * @param   buffer  The buffer of PAGEFORMAT_VALUE_SIZE.
+ * @param   value   The value.
+ * @return  Length of the formatted value.
+ */
+size_t PageFormat::_unsigned(char* buffer, const unsigned long long value) {
+  char  digits[20];
+  char* const end = digits + sizeof(digits);
+  const char* p = value <= 0xffffffffULL ? _digits(end, static_cast<uint32_t>(value)) : _digits(end, value);
+  const size_t  len = end - p;
+
+  memcpy(buffer, p, len);
+  buffer[len] = '\0';
+  return len;
+}
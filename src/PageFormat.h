@@ -0,0 +1,64 @@
+/**
+ *  Declaration of PageFormat class.
+ *  @file PageFormat.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEFORMAT_H_
+#define _PAGEFORMAT_H_
+
+#include <type_traits>
+#include <Arduino.h>
+
+// Size of the buffer that holds the formatted value with the terminator.
+#define PAGEFORMAT_VALUE_SIZE             24
+
+// Digits after the decimal point of the floating value if it is not
+// specified at the token registration, the same as the String.
+#ifndef PAGEFORMAT_PRECISION
+#define PAGEFORMAT_PRECISION              2
+#endif
+
+// Upper limit of the digits after the decimal point.
+#define PAGEFORMAT_PRECISION_MAX          9
+
+/**
+ * Formatting kernels of the values returned by the typed token
+ * handlers. The value is formatted into the buffer of
+ * PAGEFORMAT_VALUE_SIZE without the String and the printf. The format
+ * is dispatched by the type of the value.
+ */
+class PageFormat {
+ public:
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, size_t>::type
+  format(char* buffer, const T value, const uint8_t precision = 0) {
+    (void)(precision);
+    return _signed(buffer, value);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value && !std::is_same<T, bool>::value, size_t>::type
+  format(char* buffer, const T value, const uint8_t precision = 0) {
+    (void)(precision);
+    return _unsigned(buffer, value);
+  }
+
+  template<typename T>
+  static typename std::enable_if<std::is_floating_point<T>::value, size_t>::type
+  format(char* buffer, const T value, const uint8_t precision = PAGEFORMAT_PRECISION) {
+    return _float(buffer, value, precision);
+  }
+
+  static size_t format(char* buffer, const bool value, const uint8_t precision = 0);
+
+ private:
+  static size_t _float(char* buffer, const double value, uint8_t precision);
+  static size_t _signed(char* buffer, const long long value);
+  static size_t _unsigned(char* buffer, const unsigned long long value);
+};
+
+#endif // !_PAGEFORMAT_H_
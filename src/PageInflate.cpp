@@ -0,0 +1,338 @@
+/**
+ *  An implementation of the streaming decompression of the gzip mold.
+ *  @file PageInflate.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageInflate.h"
+#include "PageBuilder.h"
+
+namespace {
+  // Base and extra bits of the lengths and the distances of RFC 1951.
+  const uint16_t  _lengthBase[29] PROGMEM = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+  };
+  const uint8_t   _lengthExtra[29] PROGMEM = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+  };
+  const uint16_t  _distanceBase[30] PROGMEM = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+  };
+  const uint8_t   _distanceExtra[30] PROGMEM = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+  };
+  // Order of the code lengths of the code length alphabet.
+  const uint8_t   _lengthOrder[19] PROGMEM = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+  };
+
+  // Flags of the gzip header.
+  const uint8_t   _FHCRC = 0x02;
+  const uint8_t   _FEXTRA = 0x04;
+  const uint8_t   _FNAME = 0x08;
+  const uint8_t   _FCOMMENT = 0x10;
+}
+
+/**
+ * Skip the gzip header. The deflate stream follows it.
+ * @return  false   The mold is not the gzip with the deflate.
+ */
+bool PageInflate::begin(void) {
+  if (_length < 18 || _at(0) != 0x1f || _at(1) != 0x8b || _at(2) != 8) {
+    PB_DBG("Mold is not gzip\n");
+    _state = Error;
+    return false;
+  }
+  const uint8_t flags = _at(3);
+  _pos = 10;
+  if (flags & _FEXTRA)
+    _pos += 2 + (_at(_pos) | (_at(_pos + 1) << 8));
+  if (flags & _FNAME)
+    while (_pos < _length && _at(_pos++)) {}
+  if (flags & _FCOMMENT)
+    while (_pos < _length && _at(_pos++)) {}
+  if (flags & _FHCRC)
+    _pos += 2;
+  // The trailer of CRC32 and ISIZE is not a part of the deflate stream.
+  if (_pos + 8 > _length) {
+    _state = Error;
+    return false;
+  }
+  _length -= 8;
+  return true;
+}
+
+/**
+ * The length of the decompressed content, which the trailer of the gzip
+ * holds.
+ * @param   source  Compressed mold in the PROGMEM.
+ * @param   length  Length of the compressed mold.
+ * @return  Length of the decompressed content.
+ */
+size_t PageInflate::size(PGM_P source, const size_t length) {
+  if (length < 18)
+    return 0;
+  uint32_t  isize = 0;
+  for (uint8_t i = 1; i <= 4; i++)
+    isize = (isize << 8) | static_cast<uint8_t>(pgm_read_byte(source + length - i));
+  return isize;
+}
+
+/**
+ * Decompress the content into the buffer. The decoding stops when the
+ * buffer is filled and resumes at the next read.
+ * @param   buffer  Output buffer.
+ * @param   length  Buffer capacity.
+ * @return  Length of the decompressed content. Zero means the end of
+ * the content or the broken stream.
+ */
+size_t PageInflate::read(char* buffer, const size_t length) {
+  const uint16_t  mask = PAGEINFLATE_WINDOW - 1;
+  size_t  n = 0;
+
+  while (n < length) {
+    char  c;
+    if (_matchLength) {
+      c = _window[(_total - _matchDistance) & mask];
+      _matchLength--;
+    }
+    else if (_state == Huffman) {
+      const int symbol = _decode(_literals);
+      if (symbol < 0)
+        break;
+      if (symbol < 256)
+        c = static_cast<char>(symbol);
+      else if (symbol == 256) {
+        _state = _final ? Done : Block;
+        continue;
+      }
+      else {
+        const uint16_t  lx = symbol - 257;
+        if (lx >= 29) {
+          _state = Error;
+          break;
+        }
+        _matchLength = pgm_read_word(_lengthBase + lx) + _bits(pgm_read_byte(_lengthExtra + lx));
+        const int dx = _decode(_distances);
+        if (dx < 0 || dx >= 30) {
+          _state = Error;
+          break;
+        }
+        _matchDistance = pgm_read_word(_distanceBase + dx) + _bits(pgm_read_byte(_distanceExtra + dx));
+        // The match must be within the window and the content.
+        if (_matchDistance > PAGEINFLATE_WINDOW || _matchDistance > _total) {
+          PB_DBG("Inflate distance %u exceeds the window\n", _matchDistance);
+          _state = Error;
+          break;
+        }
+        continue;
+      }
+    }
+    else if (_state == Stored) {
+      if (!_stored) {
+        _state = _final ? Done : Block;
+        continue;
+      }
+      c = static_cast<char>(_bits(8));
+      _stored--;
+    }
+    else if (_state == Block) {
+      if (!_header())
+        break;
+      continue;
+    }
+    else
+      break;
+
+    if (_state == Error)
+      break;
+    _window[_total++ & mask] = c;
+    buffer[n++] = c;
+  }
+  if (_state == Error) {
+    PB_DBG("Inflate failed at %u\n", _pos);
+    return 0;
+  }
+  return n;
+}
+
+/**
+ * Read the block header and prepare the codes of the block.
+ * @return  false   The header is broken.
+ */
+bool PageInflate::_header(void) {
+  _final = _bits(1);
+  switch (_bits(2)) {
+  case 0:
+    // The stored block starts at the byte boundary.
+    _bitBuffer = 0;
+    _bitCount = 0;
+    _stored = _bits(16);
+    if (static_cast<uint16_t>(~_bits(16)) != _stored)
+      _state = Error;
+    else
+      _state = Stored;
+    break;
+  case 1:
+    _fixed();
+    _state = Huffman;
+    break;
+  case 2:
+    _state = _dynamic() ? Huffman : Error;
+    break;
+  default:
+    _state = Error;
+  }
+  return _state != Error;
+}
+
+/**
+ * Build the fixed codes.
+ */
+void PageInflate::_fixed(void) {
+  uint8_t lengths[288];
+  uint16_t  i = 0;
+
+  for (; i < 144; i++)
+    lengths[i] = 8;
+  for (; i < 256; i++)
+    lengths[i] = 9;
+  for (; i < 280; i++)
+    lengths[i] = 7;
+  for (; i < 288; i++)
+    lengths[i] = 8;
+  _build(_literals, lengths, 288);
+  for (i = 0; i < 30; i++)
+    lengths[i] = 5;
+  _build(_distances, lengths, 30);
+}
+
+/**
+ * Read the dynamic codes of the block.
+ * @return  false   The codes are broken.
+ */
+bool PageInflate::_dynamic(void) {
+  uint8_t lengths[288 + 32];
+  const uint16_t  nlen = _bits(5) + 257;
+  const uint16_t  ndist = _bits(5) + 1;
+  const uint16_t  ncode = _bits(4) + 4;
+
+  if (nlen > 286 || ndist > 30)
+    return false;
+  // The code of the code lengths is built in the distance code for now.
+  memset(lengths, 0, 19);
+  for (uint16_t i = 0; i < ncode; i++)
+    lengths[pgm_read_byte(_lengthOrder + i)] = _bits(3);
+  if (!_build(_distances, lengths, 19))
+    return false;
+
+  for (uint16_t i = 0; i < nlen + ndist; ) {
+    const int symbol = _decode(_distances);
+    uint8_t len = 0;
+    uint8_t repeat;
+    if (symbol < 0)
+      return false;
+    if (symbol < 16) {
+      lengths[i++] = symbol;
+      continue;
+    }
+    if (symbol == 16) {
+      if (!i)
+        return false;
+      len = lengths[i - 1];
+      repeat = 3 + _bits(2);
+    }
+    else if (symbol == 17)
+      repeat = 3 + _bits(3);
+    else
+      repeat = 11 + _bits(7);
+    if (i + repeat > nlen + ndist)
+      return false;
+    while (repeat--)
+      lengths[i++] = len;
+  }
+  // The code of the end of block must exist.
+  if (!lengths[256])
+    return false;
+  return _build(_literals, lengths, nlen) && _build(_distances, lengths + nlen, ndist) && _state != Error;
+}
+
+/**
+ * Build the canonical Huffman code from the code lengths.
+ * @param   huffman The code to be built.
+ * @param   lengths Code lengths of the symbols.
+ * @param   n       Number of the symbols.
+ * @return  false   The code is over-subscribed.
+ */
+bool PageInflate::_build(_HuffmanST& huffman, const uint8_t* lengths, const uint16_t n) {
+  uint16_t  offsets[16];
+  int left = 1;
+
+  memset(huffman.counts, 0, sizeof(huffman.counts));
+  for (uint16_t i = 0; i < n; i++)
+    huffman.counts[lengths[i]]++;
+  huffman.counts[0] = 0;
+  for (uint8_t len = 1; len < 16; len++) {
+    left <<= 1;
+    left -= huffman.counts[len];
+    if (left < 0)
+      return false;
+  }
+  offsets[1] = 0;
+  for (uint8_t len = 1; len < 15; len++)
+    offsets[len + 1] = offsets[len] + huffman.counts[len];
+  for (uint16_t i = 0; i < n; i++)
+    if (lengths[i])
+      huffman.symbols[offsets[lengths[i]]++] = i;
+  return true;
+}
+
+/**
+ * Decode a symbol with the code, a bit at a time.
+ * @param   huffman The code.
+ * @return  The symbol, or -1 if the code is invalid.
+ */
+int PageInflate::_decode(const _HuffmanST& huffman) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+
+  for (uint8_t len = 1; len < 16; len++) {
+    code |= _bits(1);
+    const int count = huffman.counts[len];
+    if (code - count < first)
+      return huffman.symbols[index + (code - first)];
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  _state = Error;
+  return -1;
+}
+
+/**
+ * Read the bits from the stream, the least significant bit first.
+ * @param   n   Number of the bits, up to 16.
+ * @return  The bits.
+ */
+uint32_t PageInflate::_bits(const uint8_t n) {
+  while (_bitCount < n) {
+    if (_pos >= _length) {
+      _state = Error;
+      return 0;
+    }
+    _bitBuffer |= static_cast<uint32_t>(_at(_pos++)) << _bitCount;
+    _bitCount += 8;
+  }
+  const uint32_t  v = _bitBuffer & ((1UL << n) - 1);
+  _bitBuffer >>= n;
+  _bitCount -= n;
+  return v;
+}
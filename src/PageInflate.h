@@ -0,0 +1,78 @@
+/**
+ *  Declaration of PageInflate class.
+ *  @file PageInflate.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEINFLATE_H_
+#define _PAGEINFLATE_H_
+
+#include <Arduino.h>
+
+// Size of the sliding window of the decompression. The mold must be
+// compressed with the window within this size, which tools/pbdeflate.py
+// does with --window 10 by default. It must be a power of 2.
+#ifndef PAGEINFLATE_WINDOW
+#define PAGEINFLATE_WINDOW                1024
+#endif
+
+/**
+ * Streaming decompression of the gzip mold placed in the PROGMEM. The
+ * deflate stream is decoded into the caller's buffer in pieces with the
+ * sliding window of PAGEINFLATE_WINDOW bytes, so the decompressed mold
+ * never resides in the heap as a whole.
+ */
+class PageInflate {
+ public:
+  PageInflate(PGM_P source, const size_t length) : _src(source), _length(length) {}
+  ~PageInflate() {}
+  bool    begin(void);
+  bool    error(void) const { return _state == Error; }
+  size_t  read(char* buffer, const size_t length);
+  static size_t size(PGM_P source, const size_t length);
+
+ protected:
+  // Decoding state between the reads.
+  enum State_t : uint8_t {
+    Block,        /**< At the block header */
+    Stored,       /**< In the stored block */
+    Huffman,      /**< In the compressed block */
+    Done,         /**< The final block has been decoded */
+    Error         /**< The stream is broken */
+  };
+
+  // Canonical Huffman code as the number of the codes of each length
+  // and the symbols in the order of the codes.
+  typedef struct {
+    uint16_t  counts[16];             /**< Number of the codes of each length */
+    uint16_t  symbols[288];           /**< Symbols ordered by the code */
+  } _HuffmanST;
+
+  uint8_t   _at(const size_t pos) const { return static_cast<uint8_t>(pgm_read_byte(_src + pos)); }
+  bool      _build(_HuffmanST& huffman, const uint8_t* lengths, const uint16_t n);
+  bool      _dynamic(void);
+  void      _fixed(void);
+  uint32_t  _bits(const uint8_t n);
+  int       _decode(const _HuffmanST& huffman);
+  bool      _header(void);
+
+  PGM_P     _src;                     /**< Compressed mold in the PROGMEM */
+  size_t    _length;                  /**< Length of the compressed mold */
+  size_t    _pos = 0;                 /**< Read position of the compressed mold */
+  uint32_t  _bitBuffer = 0;           /**< Bits that have been read ahead */
+  uint8_t   _bitCount = 0;            /**< Number of the bits read ahead */
+  State_t   _state = Block;           /**< Decoding state */
+  bool      _final = false;           /**< The current block is the final */
+  uint16_t  _stored = 0;              /**< Remaining length of the stored block */
+  uint16_t  _matchLength = 0;         /**< Remaining length of the match being copied */
+  uint16_t  _matchDistance = 0;       /**< Distance of the match being copied */
+  uint32_t  _total = 0;               /**< Length of the decompressed content */
+  _HuffmanST  _literals;              /**< Code of the literals and the lengths */
+  _HuffmanST  _distances;             /**< Code of the distances */
+  char      _window[PAGEINFLATE_WINDOW];  /**< Sliding window */
+};
+
+#endif // !_PAGEINFLATE_H_
@@ -0,0 +1,253 @@
+/**
+ *  An implementation of the HTML minifier of PageMinify class.
+ *  @file PageMinify.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include <ctype.h>
+#include "PageMinify.h"
+#include "PageBuilder.h"
+
+namespace {
+  // The elements whose content is kept as it is.
+  const char  _pre[] PROGMEM = "pre";
+  const char  _textarea[] PROGMEM = "textarea";
+  const char  _script[] PROGMEM = "script";
+  const char  _style[] PROGMEM = "style";
+  PGM_P const _rawElements[] = { _pre, _textarea, _script, _style };
+
+  inline bool _isSpace(const int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f';
+  }
+
+  // Reads the characters in the memory with the lookahead.
+  class _MemoryReader {
+   public:
+    _MemoryReader(const char* src, const size_t len) : _src(src), _len(len), _pos(0) {}
+    int   at(const size_t offset) { return _pos + offset < _len ? static_cast<uint8_t>(_src[_pos + offset]) : -1; }
+    void  skip(const size_t n) { _pos += n; }
+   private:
+    const char* _src;
+    size_t  _len;
+    size_t  _pos;
+  };
+
+  // Writes the characters to the memory. The destination may be the
+  // same as the source since the output does not overtake the input.
+  class _MemoryWriter {
+   public:
+    explicit _MemoryWriter(char* dst) : _dst(dst), _len(0) {}
+    bool  put(const char c) { _dst[_len++] = c; return true; }
+    bool  flush(void) { return true; }
+    size_t  length(void) const { return _len; }
+   private:
+    char*   _dst;
+    size_t  _len;
+  };
+
+  // Reads the file through the window that keeps the lookahead.
+  class _FileReader {
+   public:
+    explicit _FileReader(File& src) : _src(src), _pos(0), _len(0) {}
+    int   at(const size_t offset) {
+      if (_pos + offset >= _len) {
+        memmove(_window, _window + _pos, _len - _pos);
+        _len -= _pos;
+        _pos = 0;
+        _len += _src.read(reinterpret_cast<uint8_t*>(_window + _len), sizeof(_window) - _len);
+        if (offset >= _len)
+          return -1;
+      }
+      return static_cast<uint8_t>(_window[_pos + offset]);
+    }
+    void  skip(const size_t n) { _pos += n; }
+   private:
+    File&   _src;
+    size_t  _pos;
+    size_t  _len;
+    char    _window[PAGEELEMENT_FILEBUFFER_SIZE];
+  };
+
+  // Writes the file with the blocks.
+  class _FileWriter {
+   public:
+    explicit _FileWriter(File& dst) : _dst(dst), _len(0) {}
+    bool  put(const char c) {
+      _block[_len++] = c;
+      return _len < sizeof(_block) || flush();
+    }
+    bool  flush(void) {
+      const size_t  len = _len;
+      _len = 0;
+      return _dst.write(reinterpret_cast<const uint8_t*>(_block), len) == len;
+    }
+   private:
+    File&   _dst;
+    size_t  _len;
+    char    _block[PAGEELEMENT_FILEBUFFER_SIZE];
+  };
+}
+
+/**
+ * Minify the characters in the memory.
+ * @param   dst   Destination buffer, at least the length of the source.
+ * It can be the same as the source.
+ * @param   src   Source characters.
+ * @param   len   Length of the source.
+ * @return  Length of the minified characters, it is not terminated.
+ */
+size_t PageMinify::minify(char* dst, const char* src, const size_t len) {
+  _MemoryReader reader(src, len);
+  _MemoryWriter writer(dst);
+  _minify(reader, writer);
+  return writer.length();
+}
+
+/**
+ * Minify the file.
+ * @param   dst   The destination file opened for writing.
+ * @param   src   The source file opened for reading.
+ * @return  false if writing failed.
+ */
+bool PageMinify::minify(File& dst, File& src) {
+  std::unique_ptr<_FileReader>  reader(new _FileReader(src));
+  std::unique_ptr<_FileWriter>  writer(new _FileWriter(dst));
+  return _minify(*reader, *writer);
+}
+
+/**
+ * The minifier.
+ * @param   reader  Source reader with the lookahead.
+ * @param   writer  Destination writer.
+ * @return  false if writing failed.
+ */
+template<typename R, typename W>
+bool PageMinify::_minify(R& reader, W& writer) {
+  bool  space = false;
+  int   c;
+
+  while ((c = reader.at(0)) >= 0) {
+    if (_isSpace(c)) {
+      space = true;
+      reader.skip(1);
+      continue;
+    }
+
+    // The comment is stripped, except for the conditional comment.
+    if (c == '<' && _match(reader, 0, PSTR("<!--")) && reader.at(4) != '[') {
+      reader.skip(4);
+      while (reader.at(0) >= 0 && !_match(reader, 0, PSTR("-->")))
+        reader.skip(1);
+      if (reader.at(0) >= 0)
+        reader.skip(3);
+      continue;
+    }
+
+    if (space) {
+      if (!writer.put(' '))
+        return false;
+      space = false;
+    }
+
+    if (c == PAGEBUILDER_TOKENDELIMITER_OPEN && reader.at(1) == PAGEBUILDER_TOKENDELIMITER_OPEN) {
+      // The token is kept as it is.
+      while ((c = reader.at(0)) >= 0) {
+        const bool  close = c == PAGEBUILDER_TOKENDELIMITER_CLOSE && reader.at(1) == PAGEBUILDER_TOKENDELIMITER_CLOSE;
+        if (!writer.put(c))
+          return false;
+        reader.skip(1);
+        if (close) {
+          if (!writer.put(c))
+            return false;
+          reader.skip(1);
+          break;
+        }
+      }
+    }
+    else if (c == '<') {
+      // Inside the tag, the whitespace is collapsed except for the
+      // quoted attribute value.
+      PGM_P raw = _rawElement(reader);
+      char  quote = '\0';
+      bool  tagSpace = false;
+      while ((c = reader.at(0)) >= 0) {
+        reader.skip(1);
+        if (!quote && _isSpace(c)) {
+          tagSpace = true;
+          continue;
+        }
+        if (tagSpace) {
+          if (c != '>' && !writer.put(' '))
+            return false;
+          tagSpace = false;
+        }
+        if (!writer.put(c))
+          return false;
+        if (quote) {
+          if (c == quote)
+            quote = '\0';
+        }
+        else if (c == '"' || c == '\'')
+          quote = c;
+        else if (c == '>')
+          break;
+      }
+      // The content of the raw element is copied up to the end tag.
+      if (raw) {
+        while ((c = reader.at(0)) >= 0) {
+          if (c == '<' && reader.at(1) == '/' && _match(reader, 2, raw))
+            break;
+          if (!writer.put(c))
+            return false;
+          reader.skip(1);
+        }
+      }
+    }
+    else {
+      if (!writer.put(c))
+        return false;
+      reader.skip(1);
+    }
+  }
+  return writer.flush();
+}
+
+/**
+ * Compare the characters at the offset from the current position with
+ * the string ignoring the case.
+ * @param   reader  Source reader.
+ * @param   offset  Offset from the current position.
+ * @param   str     The string placed in PROGMEM.
+ * @return  true if matched.
+ */
+template<typename R>
+bool PageMinify::_match(R& reader, size_t offset, PGM_P str) {
+  char  s;
+  while ((s = static_cast<char>(pgm_read_byte(str++)))) {
+    const int c = reader.at(offset++);
+    if (c < 0 || tolower(c) != s)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Determine whether the tag at the current position opens the element
+ * whose content is kept.
+ * @param   reader  Source reader positioned at '<'.
+ * @return  Name of the element, nullptr if it is not a raw element.
+ */
+template<typename R>
+PGM_P PageMinify::_rawElement(R& reader) {
+  for (PGM_P name : _rawElements) {
+    if (_match(reader, 1, name)) {
+      const int c = reader.at(1 + strlen_P(name));
+      if (c == '>' || c == '/' || _isSpace(c))
+        return name;
+    }
+  }
+  return nullptr;
+}
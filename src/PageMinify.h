@@ -0,0 +1,38 @@
+/**
+ *  Declaration of PageMinify class.
+ *  @file PageMinify.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEMINIFY_H_
+#define _PAGEMINIFY_H_
+
+#include <Arduino.h>
+#include <FS.h>
+
+/**
+ * HTML minifier applied to the mold at loading. It collapses the runs
+ * of whitespace into a single space and strips the HTML comments. The
+ * content of pre, textarea, script and style elements, the quoted
+ * attribute values and the tokens are kept as they are. The output
+ * never exceeds the input, and the file is minified with a small
+ * window without loading the whole.
+ */
+class PageMinify {
+ public:
+  static size_t minify(char* dst, const char* src, const size_t len);
+  static bool   minify(File& dst, File& src);
+
+ private:
+  template<typename R, typename W>
+  static bool   _minify(R& reader, W& writer);
+  template<typename R>
+  static bool   _match(R& reader, size_t offset, PGM_P str);
+  template<typename R>
+  static PGM_P  _rawElement(R& reader);
+};
+
+#endif // !_PAGEMINIFY_H_
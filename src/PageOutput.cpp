@@ -0,0 +1,294 @@
+/**
+ *  An implementation of the output stage of PageOutput class.
+ *  @file PageOutput.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageOutput.h"
+#include "PageTrace.h"
+
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+QueueHandle_t PageOutput::_requests = nullptr;
+#endif
+
+/**
+ * Construct the output stage. The segment buffer is not allocated
+ * until begin.
+ * @param   server      WebServer that owns the current client.
+ * @param   flush       Flush the client at each transmission.
+ * @param   segmentSize Size of the content in a chunk.
+ */
+PageOutput::PageOutput(WebServer& server, const bool flush, const size_t segmentSize)
+: _server(server)
+, _buffer(nullptr)
+, _size(segmentSize)
+, _len(0)
+, _sent(0)
+, _flush(flush)
+, _spare(nullptr)
+, _pending(0)
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+, _idle(nullptr)
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+, _posting(0)
+, _quit(false)
+#endif
+{}
+
+/**
+ * The segment under the transmission completes before the buffers are
+ * released.
+ */
+PageOutput::~PageOutput() {
+  _join();
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+  if (_idle)
+    vSemaphoreDelete(_idle);
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+  if (_transmitterThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _quit = true;
+    }
+    _posted.notify_one();
+    _transmitterThread.join();
+  }
+#endif
+  free(_spare);
+  if (_buffer != _fallback)
+    free(_buffer);
+}
+
+/**
+ * Allocate the segment buffer. The pipeline is not mandatory, and the
+ * output stage works with the single buffer if the spare buffer or the
+ * transmitter could not be allocated. Nor is the buffer, and the
+ * output stage falls back to the small segment in itself.
+ * @param   pipeline  Transmit the segment while building the next.
+ * @return  false if the buffer could not be allocated, the content is
+ * transmitted through the fallback segment.
+ */
+bool PageOutput::begin(const bool pipeline) {
+  if (!_buffer)
+    _buffer = reinterpret_cast<char*>(malloc(_size));
+  _len = 0;
+  if (!_buffer || _buffer == _fallback) {
+    _buffer = _fallback;
+    _size = sizeof(_fallback);
+    return false;
+  }
+
+  if (pipeline && !_spare) {
+    _spare = reinterpret_cast<char*>(malloc(_size));
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+    if (_spare) {
+      _idle = xSemaphoreCreateBinary();
+      if (!_idle || !_begin()) {
+        PB_DBG("Output transmitter unavailable\n");
+        free(_spare);
+        _spare = nullptr;
+      }
+    }
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+    if (_spare)
+      _transmitterThread = std::thread(&PageOutput::_transmitter, this);
+#endif
+    if (!_spare) {
+      PB_DBG("Output pipeline unavailable, free:%u\n", ESP.getFreeHeap());
+    }
+  }
+  return true;
+}
+
+/**
+ * Commit the content that has been written directly into the tail of
+ * the segment buffer. The segment is transmitted once it is filled.
+ * With the pipeline, the filled segment is handed over to the
+ * transmission and the building continues into the spare buffer.
+ * @param   length  Length of the written content.
+ */
+void PageOutput::commit(const size_t length) {
+  _len += length;
+  if (_len >= _size) {
+    if (_spare) {
+      _join();
+      std::swap(_buffer, _spare);
+      _pending = _len;
+      _len = 0;
+      _post();
+    }
+    else
+      flush();
+  }
+  else if (_spare)
+    _pump();
+}
+
+/**
+ * Transmit the pending content as a chunk.
+ */
+void PageOutput::flush(void) {
+  _join();
+  if (_len) {
+    _transmit(_buffer, _len);
+    _sent += _len;
+    _len = 0;
+  }
+}
+
+/**
+ * Write the content through the segment buffer. The content that is
+ * large enough to fill a segment is transmitted without copying if
+ * nothing is pending.
+ * @param   data    The content.
+ * @param   length  Length of the content.
+ * @return  Length of the written content.
+ */
+size_t PageOutput::write(const char* data, size_t length) {
+  const size_t  wc = length;
+
+  while (length) {
+    if (!_len && length >= _size) {
+      _join();
+      _transmit(data, length);
+      _sent += length;
+      break;
+    }
+    const size_t  n = std::min(room(), length);
+    memcpy(tail(), data, n);
+    data += n;
+    length -= n;
+    commit(n);
+  }
+  return wc;
+}
+
+/**
+ * Transmit the content as a chunk. It runs on the transmitter as well,
+ * so the transmitted length is counted by the caller.
+ * @param   data    The content.
+ * @param   length  Length of the content.
+ */
+void PageOutput::_transmit(const char* data, const size_t length) {
+  PB_TRACE_SPAN("send", nullptr);
+  _server.sendContent_P(data, length);
+  PB_DBG_DUMB("blk:%u ", length);
+  if (_flush)
+    _server.client().flush();
+}
+
+/**
+ * Wait until the spare segment has been transmitted. Without the
+ * transmitter, the deferred segment is transmitted here.
+ */
+void PageOutput::_join(void) {
+  if (!_pending)
+    return;
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+  xSemaphoreTake(_idle, portMAX_DELAY);
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+  std::unique_lock<std::mutex> lock(_mutex);
+  _idle.wait(lock, [this]() { return !_posting; });
+#else
+  _transmit(_spare, _pending);
+#endif
+  _sent += _pending;
+  _pending = 0;
+}
+
+/**
+ * Start the transmission of the spare segment.
+ */
+void PageOutput::_post(void) {
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+  const _RequestST  request = { this, _pending };
+  xQueueSend(_requests, &request, portMAX_DELAY);
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _posting = _pending;
+  }
+  _posted.notify_one();
+#else
+  _pump();
+#endif
+}
+
+/**
+ * Transmit the deferred segment if the client can accept it without
+ * blocking. The transmitter does it by itself.
+ */
+void PageOutput::_pump(void) {
+#if !defined(PB_OUTPUT_TRANSMITTERTASK) && !defined(PB_OUTPUT_TRANSMITTERTHREAD)
+  if (_pending) {
+    const int writable = _server.client().availableForWrite();
+    if (writable > 0 && static_cast<size_t>(writable) >= _pending + PAGEOUTPUT_CHUNK_FRAMING) {
+      _transmit(_spare, _pending);
+      _sent += _pending;
+      _pending = 0;
+    }
+  }
+#endif
+}
+
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+/**
+ * Start the transmitter task at the first pipelined output. The task
+ * stays for the later responses.
+ * @return  false   The transmitter could not be started.
+ */
+bool PageOutput::_begin(void) {
+  if (_requests)
+    return true;
+  QueueHandle_t requests = xQueueCreate(PAGEOUTPUT_QUEUE_LENGTH, sizeof(_RequestST));
+  if (!requests)
+    return false;
+  if (xTaskCreate(_transmitter, "PageOutput", PAGEOUTPUT_TRANSMITTER_STACK, requests, uxTaskPriorityGet(nullptr), nullptr) != pdPASS) {
+    PB_DBG("Output transmitter creation failed\n");
+    vQueueDelete(requests);
+    return false;
+  }
+  _requests = requests;
+  return true;
+}
+
+/**
+ * The transmitter task transmits the posted segments in order, and
+ * notifies each output of the completion.
+ * @param   arg   The queue of the requests.
+ */
+void PageOutput::_transmitter(void* arg) {
+  QueueHandle_t requests = static_cast<QueueHandle_t>(arg);
+  _RequestST  request;
+
+  while (true) {
+    if (xQueueReceive(requests, &request, portMAX_DELAY) != pdTRUE)
+      continue;
+    request.output->_transmit(request.output->_spare, request.length);
+    xSemaphoreGive(request.output->_idle);
+  }
+}
+
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+/**
+ * The transmitter thread transmits the posted segments in order.
+ */
+void PageOutput::_transmitter(void) {
+  std::unique_lock<std::mutex> lock(_mutex);
+
+  while (true) {
+    _posted.wait(lock, [this]() { return _posting || _quit; });
+    if (!_posting)
+      break;
+    const size_t  length = _posting;
+    lock.unlock();
+    _transmit(_spare, length);
+    lock.lock();
+    _posting = 0;
+    _idle.notify_one();
+  }
+}
+#endif
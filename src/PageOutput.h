@@ -0,0 +1,113 @@
+/**
+ *  Declaration of PageOutput class.
+ *  @file PageOutput.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEOUTPUT_H_
+#define _PAGEOUTPUT_H_
+
+#include "PageBuilder.h"
+
+// The pipelined output transmits a filled segment while the next one is
+// being built. On ESP32 the segment is transmitted by a transmitter
+// task that is started once and serves all the outputs, and on the host
+// by a thread. Otherwise the transmission of the
+// filled segment is deferred until the client can accept it without
+// blocking. Define PB_OUTPUT_NOTASK to defer it on ESP32 as well.
+#if defined(ARDUINO_ARCH_ESP32) && !defined(PB_OUTPUT_NOTASK)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#define PB_OUTPUT_TRANSMITTERTASK
+#ifndef PAGEOUTPUT_TRANSMITTER_STACK
+#define PAGEOUTPUT_TRANSMITTER_STACK      4096
+#endif
+#ifndef PAGEOUTPUT_QUEUE_LENGTH
+#define PAGEOUTPUT_QUEUE_LENGTH           4
+#endif
+#elif !defined(ARDUINO)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define PB_OUTPUT_TRANSMITTERTHREAD
+#endif
+
+// Upper limit of the chunk framing, the size line and the two CRLFs.
+#define PAGEOUTPUT_CHUNK_FRAMING          12
+
+// Size of the segment held in the output stage itself, which is used
+// when the segment buffer cannot be allocated from the heap.
+#ifndef PAGEOUTPUT_FALLBACK_SIZE
+#define PAGEOUTPUT_FALLBACK_SIZE          128
+#endif
+
+/**
+ * The output stage for the chunked transmission of the page content.
+ * It coalesces the content written in pieces into a segment buffer and
+ * transmits it as a chunk each time the segment is filled, so that the
+ * chunk fits in a TCP segment with the chunk framing. It does not flush
+ * the client in the middle of the response unless specified. With the
+ * pipeline, it has two segment buffers and builds the content into one
+ * while the other is being transmitted. If the heap cannot afford the
+ * segment buffer, the content is transmitted in the small chunks
+ * through the fallback segment held in itself.
+ */
+class PageOutput {
+ public:
+  explicit PageOutput(WebServer& server, const bool flush = false, const size_t segmentSize = PAGEBUILDER_TRANSMIT_SEGMENT_SIZE);
+  PageOutput(const PageOutput&) = delete;
+  PageOutput& operator=(const PageOutput&) = delete;
+  ~PageOutput();
+  bool  begin(const bool pipeline = false);
+  void  commit(const size_t length);
+  void  flush(void);
+  size_t  room(void) const { return _size - _len; }
+  size_t  sent(void) const { return _sent; }
+  char* tail(void) const { return _buffer + _len; }
+  size_t  write(const char* data, size_t length);
+
+ protected:
+  void  _join(void);
+  void  _post(void);
+  void  _pump(void);
+  void  _transmit(const char* data, const size_t length);
+
+  WebServer&  _server;                /**< WebServer that owns the current client */
+  char*   _buffer;                    /**< Segment buffer */
+  size_t  _size;                      /**< Segment size */
+  size_t  _len;                       /**< Length of the content pending in the buffer */
+  size_t  _sent;                      /**< Total length of the transmitted content, updated by the caller */
+  bool    _flush;                     /**< Flush the client at each transmission */
+  char*   _spare;                     /**< The other segment buffer of the pipeline */
+  size_t  _pending;                   /**< Length of the spare segment to be transmitted */
+  char    _fallback[PAGEOUTPUT_FALLBACK_SIZE];  /**< Segment used when the buffer is not allocated */
+#if defined(PB_OUTPUT_TRANSMITTERTASK)
+  // A segment posted to the transmitter.
+  typedef struct {
+    PageOutput* output;               /**< The output that posted the segment */
+    size_t      length;               /**< Length of the spare segment */
+  } _RequestST;
+
+  static bool _begin(void);           /**< Start the transmitter */
+  static void _transmitter(void* arg);  /**< Transmitter task */
+
+  static QueueHandle_t  _requests;    /**< Segments posted to the transmitter */
+  SemaphoreHandle_t _idle;            /**< The spare segment has been transmitted */
+#elif defined(PB_OUTPUT_TRANSMITTERTHREAD)
+  void  _transmitter(void);           /**< Transmitter thread */
+
+  std::thread _transmitterThread;     /**< Transmitter thread */
+  std::mutex  _mutex;                 /**< Guards the posted length */
+  std::condition_variable _posted;    /**< The spare segment is posted or terminated */
+  std::condition_variable _idle;      /**< The spare segment has been transmitted */
+  size_t  _posting;                   /**< Length posted to the transmitter */
+  bool    _quit;                      /**< Terminate the transmitter */
+#endif
+};
+
+#endif // !_PAGEOUTPUT_H_
@@ -0,0 +1,177 @@
+/**
+ *  An implementation of the prepared page pool of PagePool class.
+ *  @file PagePool.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PagePool.h"
+
+/**
+ * Add a PageElement owned by the entry to the page.
+ * @param   mold  The mold of the element.
+ * @return  The added element.
+ */
+PageElement& PagePool::Entry::addElement(const char* mold) {
+  _elements.emplace_front(mold);
+  page.addElement(_elements.front());
+  return _elements.front();
+}
+
+/**
+ * Add a PageElement owned by the entry to the page.
+ * @param   mold  The mold of the element placed in PROGMEM.
+ * @return  The added element.
+ */
+PageElement& PagePool::Entry::addElement(const __FlashStringHelper* mold) {
+  _elements.emplace_front(mold);
+  page.addElement(_elements.front());
+  return _elements.front();
+}
+
+/**
+ * Add a PageElement owned by the entry to the page. The mold string
+ * is copied and held by the entry.
+ * @param   mold  The mold of the element.
+ * @return  The added element.
+ */
+PageElement& PagePool::Entry::addElement(const String& mold) {
+  _molds.push_front(mold);
+  return addElement(_molds.front().c_str());
+}
+
+/**
+ * Estimate the heap size of the page from the elements and the molds
+ * that the entry owns.
+ * @return  Heap size of the page.
+ */
+size_t PagePool::Entry::_footprint(void) const {
+  size_t  size = sizeof(Entry);
+  for (const PageElement& element : _elements)
+    size += sizeof(PageElement) + sizeof(PageElement*) + element.tokens().capacity() * sizeof(TokenSource);
+  for (const String& mold : _molds)
+    size += sizeof(String) + mold.length() + 1;
+  return size;
+}
+
+/**
+ * Construct the pool.
+ * @param   prepare   User function to prepare the page for the URI.
+ * @param   capacity  Maximum number of the pages held in the pool.
+ * @param   budget    Maximum heap size consumed by the pages, 0 is unlimited.
+ */
+PagePool::PagePool(PreparePageFuncT prepare, const size_t capacity, const size_t budget)
+: _prepare(prepare)
+, _capacity(capacity ? capacity : 1)
+, _budget(budget)
+, _used(0)
+{}
+
+/**
+ * Identifies the page for the request, and prepares it at the cache miss.
+ * @param   requestMethod   HTTP method of the current request.
+ * @param   requestUri      Requested URI
+ * @return  true  The pool has the page for this request.
+ */
+bool PagePool::canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  return _find(requestMethod, requestUri) != nullptr;
+}
+
+/**
+ * Identifies the page to upload.
+ * @param   uri   Requested uploading URI.
+ * @return  true  The page has the uploader.
+ */
+bool PagePool::canUpload(PageBuilderUtil::URI_TYPE_SIGNATURE uri) {
+  Entry*  entry = _find(HTTP_POST, uri);
+  return entry && entry->page.canUpload(uri);
+}
+
+/**
+ * Respond with the prepared page.
+ * @param  server         Reference of the calling WebServer instance
+ * @param  requestMethod  The HTTP request that made this call
+ * @param  requestUri     The URI for this request
+ * @return true   sent successfull
+ */
+bool PagePool::handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  Entry*  entry = _find(requestMethod, requestUri);
+  return entry && entry->page.handle(server, requestMethod, requestUri);
+}
+
+/**
+ * Forward the upload to the prepared page.
+ * @param   server      Reference of the WebServer
+ * @param   requestUri  Uploading URI
+ * @param   upload      The uploader
+ */
+void PagePool::upload(WebServer& server, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri, HTTPUpload& upload) {
+  Entry*  entry = _find(HTTP_POST, requestUri);
+  if (entry)
+    entry->page.upload(server, requestUri, upload);
+}
+
+/**
+ * Find the prepared page for the method and the URI. The found page
+ * moves to the most recently used. If the page is not found, the user
+ * function prepares a new page and the least recently used pages are
+ * evicted beyond the capacity or the budget. The request that the user
+ * function refused is remembered and not prepared again until it
+ * expires in PAGEPOOL_REFUSED_TTL.
+ * @param   method  HTTP method of the request.
+ * @param   uri     Requested URI.
+ * @return  The entry of the page, nullptr if the page is not available.
+ */
+PagePool::Entry* PagePool::_find(HTTPMethod method, const String& uri) {
+  for (auto it = _entries.begin(); it != _entries.end(); ++it) {
+    if (it->_method == method && uri == it->page.uri()) {
+      if (it != _entries.begin())
+        _entries.splice(_entries.begin(), _entries, it);
+      return &_entries.front();
+    }
+  }
+  // The refused requests expire so that they are prepared again.
+  const unsigned long now = millis();
+  _refused.remove_if([now](const _RefusedST& refused) { return now - refused.refused >= PAGEPOOL_REFUSED_TTL; });
+  for (auto it = _refused.begin(); it != _refused.end(); ++it) {
+    if (it->method == method && it->uri == uri) {
+      if (it != _refused.begin())
+        _refused.splice(_refused.begin(), _refused, it);
+      return nullptr;
+    }
+  }
+
+  if (!_prepare)
+    return nullptr;
+
+  _entries.emplace_front(method, uri);
+  Entry&  entry = _entries.front();
+  if (!_prepare(method, uri, entry)) {
+    _entries.pop_front();
+    _refused.push_front({ method, uri, now });
+    if (_refused.size() > PAGEPOOL_REFUSED_CAPACITY)
+      _refused.pop_back();
+    return nullptr;
+  }
+  // The page is sized by its own elements and molds, which does not
+  // depend on the allocations by others during the preparation.
+  entry._size = entry._footprint();
+  _used += entry._size;
+  PB_DBG("Page %s prepared, %u bytes\n", uri.c_str(), entry._size);
+  _evict();
+  return &_entries.front();
+}
+
+/**
+ * Evict the least recently used pages beyond the capacity or the budget.
+ * The most recently used page always remains.
+ */
+void PagePool::_evict(void) {
+  while (_entries.size() > 1 && (_entries.size() > _capacity || (_budget && _used > _budget))) {
+    PB_DBG("Page %s evicted\n", _entries.back().uri());
+    _used -= _entries.back()._size;
+    _entries.pop_back();
+  }
+}
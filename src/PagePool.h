@@ -0,0 +1,105 @@
+/**
+ *  Declaration of PagePool class.
+ *  @file PagePool.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEPOOL_H_
+#define _PAGEPOOL_H_
+
+#include <forward_list>
+#include <functional>
+#include <list>
+#include "PageBuilder.h"
+
+// Default number of the prepared pages to be held in the pool.
+#ifndef PAGEPOOL_CAPACITY
+#define PAGEPOOL_CAPACITY   4
+#endif
+
+// Number of the requests that the preparation refused to be remembered,
+// so that the unknown URIs do not run the preparation each time.
+#ifndef PAGEPOOL_REFUSED_CAPACITY
+#define PAGEPOOL_REFUSED_CAPACITY   8
+#endif
+
+// Milliseconds that the refused request is remembered. The request is
+// prepared again after it, since the preparation may have refused it
+// for the condition that has changed such as the free heap.
+#ifndef PAGEPOOL_REFUSED_TTL
+#define PAGEPOOL_REFUSED_TTL        60000
+#endif
+
+/**
+ * A bounded pool of the prepared dynamic pages. It is a RequestHandler
+ * that replaces the exitCanHandle function which rebuilds a single page
+ * for each URI. The pool prepares the page for the URI only at the
+ * cache miss through the user function, and holds the prepared pages
+ * while evicting the least recently used page within the capacity and
+ * the memory budget.
+ */
+class PagePool : public RequestHandler {
+ public:
+  /**
+   * A prepared page held in the pool. It owns the PageBuilder and the
+   * PageElements belonging to it, and also the molds that are given
+   * as String.
+   */
+  class Entry {
+   public:
+    Entry(HTTPMethod method, const String& uri) : _method(method), _size(0) { page.setUri(uri.c_str()); }
+    PageElement&  addElement(const char* mold);
+    PageElement&  addElement(const __FlashStringHelper* mold);
+    PageElement&  addElement(const String& mold);
+    const char* uri(void) const { return page.uri(); }
+
+    PageBuilder page;                 /**< The prepared page */
+
+   private:
+    friend class PagePool;
+    size_t  _footprint(void) const;
+    std::forward_list<PageElement>  _elements;  /**< Elements owned by the page */
+    std::forward_list<String> _molds;           /**< Molds owned by the page */
+    HTTPMethod  _method;              /**< HTTP method which the page was prepared for */
+    size_t  _size;                    /**< Heap size of the page */
+  };
+
+  // The type of user function to prepare the page for the URI.
+  typedef std::function<bool(HTTPMethod, const String&, Entry&)> PreparePageFuncT;
+
+  explicit PagePool(PreparePageFuncT prepare, const size_t capacity = PAGEPOOL_CAPACITY, const size_t budget = 0);
+  ~PagePool() {}
+  virtual bool  canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  virtual bool  canUpload(PageBuilderUtil::URI_TYPE_SIGNATURE uri) override;
+  void  clear(void) { _entries.clear(); _refused.clear(); _used = 0; }
+  bool  handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  void  insert(WebServer& server) { server.addHandler(this); }
+  size_t  size(void) const { return _entries.size(); }
+  virtual void  upload(WebServer& server, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri, HTTPUpload& upload) override;
+  size_t  used(void) const { return _used; }
+
+ protected:
+  Entry*  _find(HTTPMethod method, const String& uri);
+  void    _evict(void);
+
+  PreparePageFuncT  _prepare;         /**< User function to prepare the page */
+  size_t  _capacity;                  /**< Maximum number of the pages */
+  size_t  _budget;                    /**< Maximum heap size for the pages, 0 is unlimited */
+
+ private:
+  // A request that the preparation refused.
+  typedef struct {
+    HTTPMethod  method;               /**< HTTP method of the request */
+    String  uri;                      /**< Requested URI */
+    unsigned long refused;            /**< Time when the preparation refused it */
+  } _RefusedST;
+
+  std::list<Entry>  _entries;         /**< Prepared pages in the recently used order */
+  std::list<_RefusedST> _refused;     /**< Refused requests in the recently used order */
+  size_t  _used;                      /**< Heap size consumed by the pages */
+};
+
+#endif // !_PAGEPOOL_H_
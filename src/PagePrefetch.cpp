@@ -0,0 +1,242 @@
+/**
+ *  An implementation of the pre-evaluation of the token handlers.
+ *  @file PagePrefetch.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PagePrefetch.h"
+#include "PageTrace.h"
+#if defined(PB_PREFETCH_PARALLEL) && !defined(ARDUINO_ARCH_ESP32)
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace {
+#if defined(ARDUINO_ARCH_ESP32)
+  QueueHandle_t     _queue = nullptr;       // Jobs posted to the workers
+  SemaphoreHandle_t _completed = nullptr;   // Given at each completion
+#elif defined(PB_PREFETCH_PARALLEL)
+  // The detached workers outlive the static objects at the exit, so
+  // the pool is never destructed.
+  struct _PoolST {
+    std::mutex  mutex;
+    std::condition_variable posted;
+    std::condition_variable completed;
+    std::deque<void*> queue;
+    bool  started = false;
+  };
+  _PoolST& _pool(void) {
+    static _PoolST* pool = new _PoolST();
+    return *pool;
+  }
+#endif
+}
+
+/**
+ * The handlers which have not been consumed must complete before the
+ * jobs are released, since the workers refer to them.
+ */
+PagePrefetch::~PagePrefetch() {
+  for (_JobST& job : _jobs)
+    if (!job.taken)
+      _wait(&job);
+}
+
+/**
+ * Dispatch the handlers of the independent tokens of the elements to
+ * the workers. The same token appearing in multiple elements is
+ * evaluated for each element.
+ * @param   elements  The elements of the page.
+ * @param   args      Arguments to be passed to the token handlers.
+ */
+void PagePrefetch::dispatch(const PageElementVT& elements, const PageArgument& args) {
+#ifdef PB_PREFETCH_PARALLEL
+  if (!_begin())
+    return;
+  for (auto& element : elements) {
+    for (const TokenSource& source : element.get().tokens()) {
+      if (!source.independent)
+        continue;
+      _jobs.emplace_front(source, args);
+      _JobST* job = &_jobs.front();
+      job->args._prefetch = nullptr;
+#if defined(ARDUINO_ARCH_ESP32)
+      // If the queue is full, the handler is evaluated here.
+      if (xQueueSend(_queue, &job, 0) != pdTRUE)
+        _run(job);
+#else
+      _PoolST&  pool = _pool();
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      pool.queue.push_back(job);
+      pool.posted.notify_one();
+#endif
+    }
+  }
+#else
+  (void)(elements);
+  (void)(args);
+#endif
+}
+
+/**
+ * Take the result of the handler dispatched for the token source. It
+ * waits for the completion if the handler is still running. The handler
+ * that has not completed within the timeout is reported as not ready,
+ * and the job is left to the worker until the rendering ends.
+ * @param   source  The token source being replaced.
+ * @param   value   Returns the result of the handler.
+ * @param   ready   Returns whether the handler had the value ready.
+ * @param   timeout Milliseconds to wait for the completion.
+ * @return  false   The token has not been dispatched.
+ */
+bool PagePrefetch::take(const TokenSource& source, String& value, bool& ready, const unsigned long timeout) {
+  for (_JobST& job : _jobs) {
+    if (!job.taken && &job.source == &source) {
+      if (job.expired || !_wait(&job, timeout)) {
+        job.expired = true;
+        ready = false;
+        return true;
+      }
+      value = std::move(job.value);
+      ready = job.args._ready;
+      job.taken = true;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Start the workers at the first dispatch.
+ * @return  false   The workers could not be started.
+ */
+bool PagePrefetch::_begin(void) {
+#if defined(ARDUINO_ARCH_ESP32)
+  if (_queue)
+    return true;
+  _queue = xQueueCreate(PAGEPREFETCH_QUEUE_LENGTH, sizeof(_JobST*));
+  _completed = xSemaphoreCreateBinary();
+  uint8_t workers = 0;
+  if (_queue && _completed) {
+    // The workers run on the other core than the loop.
+    const BaseType_t  core = portNUM_PROCESSORS > 1 ? !xPortGetCoreID() : 0;
+    for (uint8_t i = 0; i < PAGEPREFETCH_WORKERS; i++) {
+      if (xTaskCreatePinnedToCore(_worker, "PagePrefetch", PAGEPREFETCH_WORKER_STACK, nullptr, uxTaskPriorityGet(nullptr), nullptr, core) == pdPASS)
+        workers++;
+      else {
+        PB_DBG("Prefetch worker %u creation failed\n", i);
+      }
+    }
+  }
+  // Without any worker, the jobs would never be taken from the queue,
+  // and the handlers are called in the mold order instead.
+  if (!workers) {
+    PB_DBG("Prefetch unavailable\n");
+    if (_queue)
+      vQueueDelete(_queue);
+    if (_completed)
+      vSemaphoreDelete(_completed);
+    _queue = nullptr;
+    _completed = nullptr;
+    return false;
+  }
+  return true;
+#elif defined(PB_PREFETCH_PARALLEL)
+  _PoolST&  pool = _pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  if (!pool.started) {
+    for (uint8_t i = 0; i < PAGEPREFETCH_WORKERS; i++)
+      std::thread(_worker, nullptr).detach();
+    pool.started = true;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Evaluate the handler and notify the completion.
+ * @param   job   The job to be evaluated.
+ */
+void PagePrefetch::_run(_JobST* job) {
+  job->args._ready = true;
+  {
+    PB_TRACE_SPAN("token", job->source.name());
+    job->value = job->source.builder(job->args);
+  }
+#if defined(ARDUINO_ARCH_ESP32)
+  job->done = true;
+  xSemaphoreGive(_completed);
+#elif defined(PB_PREFETCH_PARALLEL)
+  _PoolST&  pool = _pool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  job->done = true;
+  pool.completed.notify_all();
+#else
+  job->done = true;
+#endif
+}
+
+/**
+ * Wait for the completion of the job.
+ * @param   job     The job to be waited.
+ * @param   timeout Milliseconds to wait, ULONG_MAX waits until it completes.
+ * @return  false   The job has not completed within the timeout.
+ */
+bool PagePrefetch::_wait(_JobST* job, const unsigned long timeout) {
+#if defined(ARDUINO_ARCH_ESP32)
+  // The completion is given for any job, so it checks the job again
+  // at least every tick.
+  const unsigned long start = millis();
+  while (!job->done) {
+    if (timeout != ULONG_MAX && millis() - start >= timeout)
+      return false;
+    xSemaphoreTake(_completed, 1);
+  }
+  return true;
+#elif defined(PB_PREFETCH_PARALLEL)
+  _PoolST&  pool = _pool();
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  if (timeout == ULONG_MAX) {
+    pool.completed.wait(lock, [job]() { return job->done.load(); });
+    return true;
+  }
+  return pool.completed.wait_for(lock, std::chrono::milliseconds(timeout), [job]() { return job->done.load(); });
+#else
+  (void)(job);
+  (void)(timeout);
+  return true;
+#endif
+}
+
+/**
+ * The worker evaluates the posted jobs in order.
+ * @param   arg   Not used.
+ */
+void PagePrefetch::_worker(void* arg) {
+  (void)(arg);
+  while (true) {
+    _JobST* job = nullptr;
+#if defined(ARDUINO_ARCH_ESP32)
+    if (xQueueReceive(_queue, &job, portMAX_DELAY) != pdTRUE)
+      continue;
+#elif defined(PB_PREFETCH_PARALLEL)
+    {
+      _PoolST&  pool = _pool();
+      std::unique_lock<std::mutex> lock(pool.mutex);
+      pool.posted.wait(lock, [&pool]() { return !pool.queue.empty(); });
+      job = static_cast<_JobST*>(pool.queue.front());
+      pool.queue.pop_front();
+    }
+#else
+    return;
+#endif
+    _run(job);
+  }
+}
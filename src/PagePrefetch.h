@@ -0,0 +1,82 @@
+/**
+ *  Declaration of PagePrefetch class.
+ *  @file PagePrefetch.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEPREFETCH_H_
+#define _PAGEPREFETCH_H_
+
+#include <atomic>
+#include <forward_list>
+#include "PageBuilder.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+// The independent token handlers are evaluated by the workers on ESP32
+// and on the host with std::thread. ESP8266 has no thread to run them,
+// and the handlers are called in the mold order as usual.
+#if defined(ARDUINO_ARCH_ESP32) || !defined(ARDUINO)
+#define PB_PREFETCH_PARALLEL
+#endif
+
+// Number of the workers. On ESP32, the worker tasks run on the core
+// other than the one the loop runs on. A single worker would serialize
+// the handlers, which defeats the parallel evaluation.
+#ifndef PAGEPREFETCH_WORKERS
+#define PAGEPREFETCH_WORKERS              2
+#endif
+#ifndef PAGEPREFETCH_QUEUE_LENGTH
+#define PAGEPREFETCH_QUEUE_LENGTH         8
+#endif
+#ifndef PAGEPREFETCH_WORKER_STACK
+#define PAGEPREFETCH_WORKER_STACK         4096
+#endif
+
+/**
+ * Pre-evaluation of the token handlers for a rendering of the page.
+ * The handlers of the tokens marked as independent are dispatched to
+ * the workers when the rendering starts, and the lexer consumes each
+ * result in the mold order as it completes, so the literals are output
+ * while the handlers are running. Each handler receives a copy of the
+ * arguments and must not share the state with the other handlers. The
+ * jobs refer to the token sources of the elements, so the tokens and
+ * the molds must not be changed while the page is being rendered.
+ */
+class PagePrefetch {
+ public:
+  PagePrefetch() {}
+  PagePrefetch(const PagePrefetch&) = delete;
+  PagePrefetch& operator=(const PagePrefetch&) = delete;
+  ~PagePrefetch();
+  void  dispatch(const PageElementVT& elements, const PageArgument& args);
+  bool  take(const TokenSource& source, String& value, bool& ready, const unsigned long timeout = ULONG_MAX);
+
+ protected:
+  // A handler evaluation dispatched to the worker.
+  typedef struct _Job {
+    _Job(const TokenSource& source, const PageArgument& args) : source(source), args(args) {}
+    const TokenSource&  source;       /**< Token source to be evaluated */
+    PageArgument  args;               /**< Arguments owned by the handler */
+    String  value;                    /**< Result of the handler */
+    std::atomic<bool> done{false};    /**< The handler has returned */
+    bool    taken = false;            /**< The result has been consumed */
+    bool    expired = false;          /**< The wait has timed out */
+  } _JobST;
+
+  static bool _begin(void);           /**< Start the workers */
+  static void _run(_JobST* job);      /**< Evaluate the handler */
+  static bool _wait(_JobST* job, const unsigned long timeout = ULONG_MAX);  /**< Wait for the completion */
+  static void _worker(void* arg);     /**< Worker loop */
+
+  std::forward_list<_JobST> _jobs;    /**< Jobs of the current rendering */
+};
+
+#endif // !_PAGEPREFETCH_H_
@@ -0,0 +1,228 @@
+/**
+ *  An implementation of the route dispatch of PageRouter class.
+ *  @file PageRouter.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageRouter.h"
+
+namespace {
+  // Get the length of the path segment that starts at p.
+  size_t _segmentLength(const char* p) {
+    const char* e = p;
+    while (*e && *e != '/')
+      e++;
+    return e - p;
+  }
+
+  // Decode the percent-encoded path segment. The plus sign is not a
+  // space in the path.
+  String  _decodeSegment(const char* p, const size_t len) {
+    String  value;
+    value.reserve(len);
+    for (size_t i = 0; i < len; i++) {
+      if (p[i] == '%' && i + 2 < len && isHexadecimalDigit(p[i + 1]) && isHexadecimalDigit(p[i + 2])) {
+        const char  hex[3] = { p[i + 1], p[i + 2], '\0' };
+        value += static_cast<char>(strtol(hex, nullptr, 16));
+        i += 2;
+      }
+      else
+        value += p[i];
+    }
+    return value;
+  }
+}
+
+/**
+ * Add a route of the page.
+ * @param   pattern   URI pattern of the route. A segment enclosed in
+ * braces such as {id} matches any segment and captures it as the path
+ * parameter named id.
+ * @param   page      PageBuilder to respond to the route.
+ * @return  false if the pattern is invalid.
+ */
+bool PageRouter::add(const char* pattern, PageBuilder& page) {
+  if (!pattern || *pattern != '/')
+    return false;
+
+  _RouteNodeST* node = &_root;
+  const char* p = pattern;
+  while (*p == '/') {
+    p++;
+    const size_t  len = _segmentLength(p);
+    bool  param = len >= 2 && p[0] == PAGEROUTER_PARAMDELIMITER_OPEN && p[len - 1] == PAGEROUTER_PARAMDELIMITER_CLOSE;
+    String  segment;
+    if (param)
+      segment.concat(p + 1, len - 2);
+    else
+      segment.concat(p, len);
+    p += len;
+
+    // The trailing slash of the pattern is a segment of an empty string.
+    if (!*p && !len && node == &_root)
+      break;
+
+    _RouteNodeST* child = nullptr;
+    for (auto& c : node->children) {
+      if (c->param == param && c->segment == segment) {
+        child = c.get();
+        break;
+      }
+    }
+    if (!child) {
+      node->children.emplace_back(new _RouteNodeST());
+      child = node->children.back().get();
+      child->segment = segment;
+      child->param = param;
+    }
+    node = child;
+  }
+  node->pages.push_back(&page);
+  _cache = nullptr;
+  PB_DBG("Route %s added\n", pattern);
+  return true;
+}
+
+/**
+ * Identifies the page to respond to the request. The result is cached
+ * for the successive call with the same request.
+ * @param   requestMethod   HTTP method of the current request.
+ * @param   requestUri      Requested URI
+ * @return  true  the PageRouter has the page for this request.
+ */
+bool PageRouter::canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  return _match(requestMethod, requestUri) != nullptr;
+}
+
+/**
+ * Identifies the page to upload.
+ * @param   uri   Requested uploading URI.
+ * @return  true  The page has the uploader.
+ */
+bool PageRouter::canUpload(PageBuilderUtil::URI_TYPE_SIGNATURE uri) {
+  PageBuilder*  page = _match(HTTP_POST, uri);
+  return page && page->_upload;
+}
+
+/**
+ * Clear all routes.
+ */
+void PageRouter::clear(void) {
+  _root.pages.clear();
+  _root.children.clear();
+  _cache = nullptr;
+}
+
+/**
+ * Dispatch the request to the matched page.
+ * @param  server         Reference of the calling WebServer instance
+ * @param  requestMethod  The HTTP request that made this call
+ * @param  requestUri     The URI for this request
+ * @return true   sent successfull
+ * @return false  No route matched.
+ */
+bool PageRouter::handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) {
+  PageBuilder*  page = _match(requestMethod, requestUri);
+  if (!page)
+    return false;
+  PB_DBG("Routed %s\n", requestUri.c_str());
+  const bool  rc = page->_respond(server, &_cacheParams);
+  // The request has been completed. The cache is discarded so as not
+  // to retain the path parameters.
+  _cache = nullptr;
+  _cacheUri = String();
+  _cacheParams = PageArgument();
+  return rc;
+}
+
+/**
+ * Forward the upload to the matched page.
+ * @param   server      Reference of the WebServer
+ * @param   requestUri  Uploading URI
+ * @param   upload      The uploader
+ */
+void PageRouter::upload(WebServer& server, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri, HTTPUpload& upload) {
+  (void)(server);
+  PageBuilder*  page = _match(HTTP_POST, requestUri);
+  if (page && page->_upload)
+    page->_upload(requestUri, upload);
+}
+
+/**
+ * Find the page for the request with the route trie, or get it from
+ * the cache if the request is the same as the last.
+ * @param   method  HTTP method of the request.
+ * @param   uri     Requested URI.
+ * @return  The matched page, nullptr if no route matched.
+ */
+PageBuilder* PageRouter::_match(HTTPMethod method, const String& uri) {
+  if (_cache && method == _cacheMethod && uri.length() == _cacheUri.length() && uri == _cacheUri)
+    return _cache;
+
+  PageArgument  params;
+  const char* path = uri.c_str();
+  if (*path != '/')
+    return nullptr;
+  // The root is matched with the path as "/" and "" alike.
+  if (!path[1])
+    path++;
+  PageBuilder*  page = _search(_root, method, uri, path, params);
+  if (page) {
+    _cache = page;
+    _cacheMethod = method;
+    _cacheUri = uri;
+    _cacheParams = params;
+  }
+  return page;
+}
+
+/**
+ * Search the route trie for the path recursively. The literal segment
+ * takes precedence over the path parameter. The page that has the exit
+ * of canHandle is matched only if the exit accepts the request, the
+ * same as the page inserted into the WebServer.
+ * @param   node    The node that matched the preceding segments.
+ * @param   method  HTTP method of the request.
+ * @param   uri     Requested URI.
+ * @param   path    The remaining path which starts with '/'.
+ * @param   params  Captured path parameters.
+ * @return  The matched page, nullptr if no route matched.
+ */
+PageBuilder* PageRouter::_search(const _RouteNodeST& node, HTTPMethod method, const String& uri, const char* path, PageArgument& params) const {
+  if (!*path) {
+    for (PageBuilder* page : node.pages) {
+      if (page->_method != HTTP_ANY && page->_method != method)
+        continue;
+      if (!page->_canHandle || page->_canHandle(method, uri))
+        return page;
+    }
+    return nullptr;
+  }
+
+  const char* segment = path + 1;
+  const size_t  len = _segmentLength(segment);
+  for (const auto& child : node.children) {
+    if (!child->param && child->segment.length() == len && !strncmp(child->segment.c_str(), segment, len)) {
+      PageBuilder*  page = _search(*child, method, uri, segment + len, params);
+      if (page)
+        return page;
+    }
+  }
+  if (len) {
+    for (const auto& child : node.children) {
+      if (child->param) {
+        PageArgument  captured(params);
+        captured.push(child->segment, _decodeSegment(segment, len));
+        PageBuilder*  page = _search(*child, method, uri, segment + len, captured);
+        if (page) {
+          params = captured;
+          return page;
+        }
+      }
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,67 @@
+/**
+ *  Declaration of PageRouter class.
+ *  @file PageRouter.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEROUTER_H_
+#define _PAGEROUTER_H_
+
+#include <memory>
+#include <vector>
+#include "PageBuilder.h"
+
+// Delimiter pair of the path parameter in the route pattern.
+#ifndef PAGEROUTER_PARAMDELIMITER_OPEN
+#define PAGEROUTER_PARAMDELIMITER_OPEN    '{'
+#endif
+#ifndef PAGEROUTER_PARAMDELIMITER_CLOSE
+#define PAGEROUTER_PARAMDELIMITER_CLOSE   '}'
+#endif
+
+/**
+ * A single RequestHandler that dispatches the requests to multiple
+ * PageBuilders. The routes are held in a trie of the path segments, and
+ * the segment enclosed in braces such as /user/{id} captures the path
+ * parameter which is passed to the token handlers as PageArgument.
+ * The result of matching is cached for the successive canHandle and
+ * handle calls of the WebServer for the same request.
+ */
+class PageRouter : public RequestHandler {
+ public:
+  PageRouter() : _cache(nullptr) {}
+  ~PageRouter() {}
+  bool  add(PageBuilder& page) { return add(page.uri(), page); }
+  bool  add(const char* pattern, PageBuilder& page);
+  virtual bool  canHandle(HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  virtual bool  canUpload(PageBuilderUtil::URI_TYPE_SIGNATURE uri) override;
+  void  clear(void);
+  bool  handle(WebServer& server, HTTPMethod requestMethod, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri) override;
+  void  insert(WebServer& server) { server.addHandler(this); }
+  virtual void  upload(WebServer& server, PageBuilderUtil::URI_TYPE_SIGNATURE requestUri, HTTPUpload& upload) override;
+
+ protected:
+  // A node of the route trie corresponds to a path segment.
+  typedef struct _RouteNode {
+    String  segment;                  /**< Literal segment or the parameter name */
+    bool    param;                    /**< The segment captures a path parameter */
+    std::vector<PageBuilder*> pages;  /**< Pages terminating at this node */
+    std::vector<std::unique_ptr<struct _RouteNode>> children; /**< Subsequent segments */
+  } _RouteNodeST;
+
+  PageBuilder*  _match(HTTPMethod method, const String& uri);
+  PageBuilder*  _search(const _RouteNodeST& node, HTTPMethod method, const String& uri, const char* path, PageArgument& params) const;
+
+  _RouteNodeST  _root;                /**< Root of the route trie */
+
+ private:
+  PageBuilder*  _cache;               /**< Page matched by the last request */
+  HTTPMethod    _cacheMethod;         /**< Method of the last request */
+  String        _cacheUri;            /**< URI of the last request */
+  PageArgument  _cacheParams;         /**< Path parameters of the last request */
+};
+
+#endif // !_PAGEROUTER_H_
@@ -0,0 +1,134 @@
+/**
+ *  Word-at-a-time scanning primitives used by the PageBuilder lexer and
+ *  the token escaping.
+ *  @file PageScan.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGESCAN_H_
+#define _PAGESCAN_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <Arduino.h>
+
+namespace PageBuilderUtil {
+  /**
+   * SWAR (SIMD within a register) helpers. The scanning word follows
+   * the native register width, 32 bits on Xtensa and RISC-V and 64 bits
+   * on a host. Each test returns a mask that has the high bit set in
+   * every byte lane which satisfies the condition. Only the lowest
+   * flagged lane is exact, which is all a forward scan needs.
+   */
+  namespace SWAR {
+#if UINTPTR_MAX > 0xffffffffUL
+    typedef uint64_t  word_t;
+#else
+    typedef uint32_t  word_t;
+#endif
+    static const word_t ones  = ~static_cast<word_t>(0) / 0xff;
+    static const word_t highs = ones * 0x80;
+
+    inline word_t broadcast(const uint8_t c) { return ones * c; }
+    inline word_t hasZero(const word_t v) { return (v - ones) & ~v & highs; }
+    inline word_t hasByte(const word_t v, const uint8_t c) { return hasZero(v ^ broadcast(c)); }
+    // The n must not exceed 128.
+    inline word_t hasLess(const word_t v, const uint8_t n) { return (v - broadcast(n)) & ~v & highs; }
+
+    // Loads a word from the aligned address. It is the same as the
+    // pgm_read_dword access, so it is also valid for the PROGMEM area.
+    inline word_t load(const char* p) {
+      word_t  v;
+      memcpy(&v, __builtin_assume_aligned(p, sizeof(word_t)), sizeof(word_t));
+      return v;
+    }
+
+    // Byte offset of the lowest flagged lane of the mask.
+    inline size_t first(const word_t mask) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      return (sizeof(word_t) == 8 ? __builtin_clzll(mask) : __builtin_clz(mask)) >> 3;
+#else
+      return (sizeof(word_t) == 8 ? __builtin_ctzll(mask) : __builtin_ctz(mask)) >> 3;
+#endif
+    }
+
+    // Number of bytes until the address is aligned to the word.
+    inline size_t misalign(const char* p) {
+      return (sizeof(word_t) - (reinterpret_cast<uintptr_t>(p) & (sizeof(word_t) - 1))) & (sizeof(word_t) - 1);
+    }
+  }
+
+  /**
+   * Scans the nul terminated characters for the delimiter. Aligned
+   * words are loaded, it never reads beyond the word which contains the
+   * terminator and it is valid for the PROGMEM area as well.
+   * @param  s        The characters to scan.
+   * @param  delim    The delimiter character.
+   * @param  progmem  The characters are placed in the PROGMEM area.
+   * @param  limit    Upper limit of the run length.
+   * @return Length of the run up to the delimiter or the terminator.
+   */
+  inline size_t scanDelimiter(const char* s, const char delim, const bool progmem, const size_t limit) {
+#if !defined(ARDUINO)
+    // The host C library has the vectorized implementation.
+    (void)(progmem);
+    const size_t  len = strnlen(s, limit);
+    const char* found = static_cast<const char*>(memchr(s, delim, len));
+    return found ? found - s : len;
+#else
+    using namespace SWAR;
+    const char* p = s;
+    const size_t  head = misalign(p);
+    for (size_t i = 0; i < head; i++, p++) {
+      const char  c = progmem ? static_cast<char>(pgm_read_byte(p)) : *p;
+      if (!c || c == delim || static_cast<size_t>(p - s) >= limit)
+        return std::min(static_cast<size_t>(p - s), limit);
+    }
+    const word_t  d = broadcast(static_cast<uint8_t>(delim));
+    for (; static_cast<size_t>(p - s) < limit; p += sizeof(word_t)) {
+      const word_t  w = load(p);
+      const word_t  mask = hasZero(w) | hasZero(w ^ d);
+      if (mask)
+        return std::min(p - s + first(mask), limit);
+    }
+    return limit;
+#endif
+  }
+
+  /**
+   * Scans the characters of known length for the delimiter.
+   * @param  s      The characters to scan.
+   * @param  len    Length of the characters.
+   * @param  delim  The delimiter character.
+   * @return Length of the run up to the delimiter, len if not found.
+   */
+  inline size_t scanDelimiter(const char* s, const size_t len, const char delim) {
+#if !defined(ARDUINO)
+    const char* found = static_cast<const char*>(memchr(s, delim, len));
+    return found ? found - s : len;
+#else
+    using namespace SWAR;
+    size_t  pos = 0;
+    const size_t  head = misalign(s);
+    for (; pos < head && pos < len; pos++)
+      if (s[pos] == delim)
+        return pos;
+    const word_t  d = broadcast(static_cast<uint8_t>(delim));
+    for (; pos + sizeof(word_t) <= len; pos += sizeof(word_t)) {
+      const word_t  mask = hasZero(load(s + pos) ^ d);
+      if (mask)
+        return pos + first(mask);
+    }
+    for (; pos < len; pos++)
+      if (s[pos] == delim)
+        break;
+    return pos;
+#endif
+  }
+}
+
+#endif // !_PAGESCAN_H_
@@ -0,0 +1,181 @@
+/**
+ *  An implementation of the authenticated session of PageSession class.
+ *  @file PageSession.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageSession.h"
+
+namespace {
+  // The cookie value consists of the expiry with 8 hexadecimal digits
+  // followed by the tag with 32 digits.
+  const size_t  _expiryLength = 8;
+  const size_t  _tagLength = PAGESESSION_TAG_SIZE * 2;
+
+  void _toHex(char* dst, uint32_t v, size_t digits) {
+    static const char _hexDigits[] = "0123456789abcdef";
+    while (digits--) {
+      dst[digits] = _hexDigits[v & 0xf];
+      v >>= 4;
+    }
+  }
+}
+
+/**
+ * Construct the session store with the random secret key.
+ * @param   ttl   Lifetime of the session in seconds.
+ */
+PageSession::PageSession(const unsigned long ttl) {
+  setTTL(ttl);
+  revoke();
+}
+
+/**
+ * Regenerate the secret key. All the sessions issued so far are
+ * invalidated.
+ */
+void PageSession::revoke(void) {
+  for (size_t i = 0; i < sizeof(_key); i += sizeof(uint32_t)) {
+#if defined(ARDUINO_ARCH_ESP8266)
+    const uint32_t  k = ESP.random();
+#elif defined(ARDUINO_ARCH_ESP32)
+    const uint32_t  k = esp_random();
+#endif
+    memcpy(_key + i, &k, sizeof(k));
+  }
+}
+
+/**
+ * Issue the session cookie for the certified request. It is sent with
+ * the response header.
+ * @param   server    Reference of the WebServer instance.
+ * @param   username  Username of the page.
+ * @param   password  Password of the page.
+ */
+void PageSession::_issue(WebServer& server, const String& username, const String& password) const {
+  char  value[_expiryLength + _tagLength + 1];
+  const uint32_t  expiry = static_cast<uint32_t>(millis() + _ttl * 1000UL);
+
+  _toHex(value, expiry, _expiryLength);
+  _sign(value + _expiryLength, expiry, username, password);
+  value[_expiryLength + _tagLength] = '\0';
+  String  cookie(F(PAGESESSION_COOKIE "="));
+  cookie += value;
+  cookie += F("; Path=/; Max-Age=");
+  cookie += String(_ttl);
+  cookie += F("; HttpOnly; SameSite=Strict");
+  server.sendHeader(F("Set-Cookie"), cookie);
+}
+
+/**
+ * Verify the session cookie of the request. The tag is compared in the
+ * constant time. The Cookie header must be collected by the WebServer
+ * with PageBuilder::collectHeaders.
+ * @param   server    Reference of the WebServer instance.
+ * @param   username  Username of the page.
+ * @param   password  Password of the page.
+ * @return  true  The request has the valid session.
+ */
+bool PageSession::_verify(WebServer& server, const String& username, const String& password) const {
+  if (!server.hasHeader(F("Cookie")))
+    return false;
+  const String  cookies = server.header(F("Cookie"));
+  const char* p = cookies.c_str();
+  const size_t  nameLength = sizeof(PAGESESSION_COOKIE) - 1;
+
+  // Find the session cookie among the cookies separated by semicolon.
+  while (*p) {
+    while (*p == ' ' || *p == ';')
+      p++;
+    if (!strncmp(p, PAGESESSION_COOKIE, nameLength) && p[nameLength] == '=')
+      break;
+    p = strchr(p, ';');
+    if (!p)
+      return false;
+  }
+  if (!*p)
+    return false;
+  p += nameLength + 1;
+  if (strcspn(p, "; ") != _expiryLength + _tagLength)
+    return false;
+
+  uint32_t  expiry = 0;
+  for (size_t i = 0; i < _expiryLength; i++) {
+    const char  c = p[i];
+    if (!isxdigit(c))
+      return false;
+    expiry = (expiry << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+  }
+  // The remaining lifetime beyond the TTL means that it has expired
+  // and wrapped around.
+  if (expiry - static_cast<uint32_t>(millis()) > _ttl * 1000UL)
+    return false;
+
+  char  tag[_tagLength];
+  uint8_t diff = 0;
+  _sign(tag, expiry, username, password);
+  for (size_t i = 0; i < _tagLength; i++)
+    diff |= tag[i] ^ p[_expiryLength + i];
+  return !diff;
+}
+
+/**
+ * Generate the tag of the session in hexadecimal. The credentials are
+ * signed together, so that the session is valid only for the pages
+ * with the same credentials. The username of the Basic and the Digest
+ * cannot contain the colon, which separates it from the password.
+ * @param   tag       Returns the tag of 32 digits, not terminated.
+ * @param   expiry    Expiry of the session.
+ * @param   username  Username of the page.
+ * @param   password  Password of the page.
+ */
+void PageSession::_sign(char* tag, const uint32_t expiry, const String& username, const String& password) const {
+  char    expiryHex[_expiryLength + 1];
+  _toHex(expiryHex, expiry, _expiryLength);
+  expiryHex[_expiryLength] = '\0';
+  String  message;
+  message.reserve(_expiryLength + username.length() + password.length() + 2);
+  message += expiryHex;
+  message += '|';
+  message += username;
+  message += ':';
+  message += password;
+  uint8_t digest[PAGESESSION_DIGEST_SIZE];
+  _hmac(digest, _key, reinterpret_cast<const uint8_t*>(message.c_str()), message.length());
+  for (size_t i = 0; i < PAGESESSION_TAG_SIZE; i++)
+    _toHex(tag + i * 2, digest[i], 2);
+}
+
+/**
+ * HMAC-SHA256 with the secret key, by the BearSSL of ESP8266 and the
+ * mbedTLS of ESP32.
+ * @param   digest  Returns the digest of PAGESESSION_DIGEST_SIZE bytes.
+ * @param   key     The key of PAGESESSION_KEY_SIZE bytes.
+ * @param   data    The message.
+ * @param   length  Length of the message.
+ */
+void PageSession::_hmac(uint8_t* digest, const uint8_t* key, const uint8_t* data, const size_t length) {
+#if defined(ARDUINO_ARCH_ESP8266)
+  br_hmac_key_context kc;
+  br_hmac_context hc;
+  br_hmac_key_init(&kc, &br_sha256_vtable, key, PAGESESSION_KEY_SIZE);
+  br_hmac_init(&hc, &kc, 0);
+  br_hmac_update(&hc, data, length);
+  br_hmac_out(&hc, digest);
+#elif defined(ARDUINO_ARCH_ESP32)
+  mbedtls_md_context_t  ctx;
+  mbedtls_md_init(&ctx);
+  if (mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1)
+    || mbedtls_md_hmac_starts(&ctx, key, PAGESESSION_KEY_SIZE)
+    || mbedtls_md_hmac_update(&ctx, data, length)
+    || mbedtls_md_hmac_finish(&ctx, digest)) {
+    // The session cannot be verified with the digest of the failure.
+    PB_DBG("Session HMAC failed\n");
+    esp_fill_random(digest, PAGESESSION_DIGEST_SIZE);
+  }
+  mbedtls_md_free(&ctx);
+#endif
+}
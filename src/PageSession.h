@@ -0,0 +1,71 @@
+/**
+ *  Declaration of PageSession class.
+ *  @file PageSession.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGESESSION_H_
+#define _PAGESESSION_H_
+
+#include "PageBuilder.h"
+#if defined(ARDUINO_ARCH_ESP8266)
+#include <bearssl/bearssl_hmac.h>
+#elif defined(ARDUINO_ARCH_ESP32)
+#include <mbedtls/md.h>
+#else
+#error "PageSession requires the HMAC and the random of ESP8266 or ESP32"
+#endif
+
+// Name of the session cookie.
+#ifndef PAGESESSION_COOKIE
+#define PAGESESSION_COOKIE                "PBSESSION"
+#endif
+
+// Lifetime of the session in seconds.
+#ifndef PAGESESSION_TTL
+#define PAGESESSION_TTL                   600
+#endif
+
+// The expiry is measured with millis, so the lifetime is limited to
+// less than the half of its wraparound.
+#define PAGESESSION_TTL_MAX               2000000UL
+
+// Length of the secret key and of the HMAC-SHA256 digest in bytes, and
+// of the tag truncated from the digest.
+#define PAGESESSION_KEY_SIZE              32
+#define PAGESESSION_DIGEST_SIZE           32
+#define PAGESESSION_TAG_SIZE              16
+
+/**
+ * The session store of the authenticated pages. After a successful
+ * authentication, the page issues a cookie that carries the expiry and
+ * the HMAC-SHA256 of the expiry and the credentials of the page signed
+ * with the secret key of the store, truncated to 128 bits. The
+ * subsequent requests to the pages sharing the store are certified by
+ * verifying the cookie without the credential check. The secret key is
+ * generated at random for each boot, which invalidates the sessions
+ * issued before.
+ */
+class PageSession {
+  friend class PageBuilder;
+
+ public:
+  explicit PageSession(const unsigned long ttl = PAGESESSION_TTL);
+  ~PageSession() {}
+  void  revoke(void);
+  void  setTTL(const unsigned long ttl) { _ttl = std::min(ttl, PAGESESSION_TTL_MAX); }
+
+ protected:
+  void  _issue(WebServer& server, const String& username, const String& password) const;
+  bool  _verify(WebServer& server, const String& username, const String& password) const;
+  void  _sign(char* tag, const uint32_t expiry, const String& username, const String& password) const;
+  static void _hmac(uint8_t* digest, const uint8_t* key, const uint8_t* data, const size_t length);
+
+  unsigned long _ttl;                 /**< Lifetime of the session in seconds */
+  uint8_t   _key[PAGESESSION_KEY_SIZE];   /**< Secret key of the HMAC */
+};
+
+#endif // !_PAGESESSION_H_
@@ -0,0 +1,259 @@
+/**
+ *  An implementation of the render tracing in the Chrome trace-event
+ *  format.
+ *  @file PageTrace.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageTrace.h"
+#include "PageOutput.h"
+#if !defined(ARDUINO)
+#include <cstdio>
+#include <thread>
+#endif
+
+#if defined(ARDUINO_ARCH_ESP8266)
+bool  PageTrace::_active = false;
+#else
+std::atomic<bool> PageTrace::_active(false);
+#endif
+std::unique_ptr<PageTrace::_SpanST[]> PageTrace::_spans;
+size_t  PageTrace::_capacity = 0;
+size_t  PageTrace::_head = 0;
+size_t  PageTrace::_count = 0;
+#if defined(ARDUINO_ARCH_ESP32)
+portMUX_TYPE  PageTrace::_mux = portMUX_INITIALIZER_UNLOCKED;
+#elif !defined(ARDUINO)
+std::mutex  PageTrace::_mutex;
+#endif
+
+namespace {
+  // Writes the trace into the output stage of the response.
+  class _OutputPrint : public Print {
+   public:
+    explicit _OutputPrint(PageOutput& output) : _output(output) {}
+    size_t write(uint8_t c) override { return _output.write(reinterpret_cast<const char*>(&c), 1); }
+    size_t write(const uint8_t* buffer, size_t size) override { return _output.write(reinterpret_cast<const char*>(buffer), size); }
+   private:
+    PageOutput& _output;
+  };
+
+#if !defined(ARDUINO)
+  // Writes the trace into the file of the host.
+  class _FilePrint : public Print {
+   public:
+    explicit _FilePrint(FILE* file) : _file(file) {}
+    size_t write(uint8_t c) override { return fwrite(&c, 1, 1, _file); }
+    size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, _file); }
+   private:
+    FILE* _file;
+  };
+#endif
+
+  // Identifies the thread on which the span ran.
+  uint32_t _threadId(void) {
+#if defined(ARDUINO_ARCH_ESP32)
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(xTaskGetCurrentTaskHandle()));
+#elif !defined(ARDUINO)
+    return static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#else
+    return 1;
+#endif
+  }
+}
+
+/**
+ * Start recording the spans. The spans recorded so far are discarded.
+ * @param   capacity  Number of the spans that the ring buffer holds.
+ * @return  false   The ring buffer could not be allocated.
+ */
+bool PageTrace::begin(const size_t capacity) {
+  std::unique_ptr<_SpanST[]>  spans(new (std::nothrow) _SpanST[capacity]);
+  if (!spans || !capacity) {
+    PB_DBG("Trace buffer allocation failed, free:%u\n", ESP.getFreeHeap());
+    return false;
+  }
+  _lock();
+  _spans.swap(spans);
+  _capacity = capacity;
+  _head = 0;
+  _count = 0;
+  _active = true;
+  _unlock();
+  return true;
+}
+
+/**
+ * Discard the recorded spans.
+ */
+void PageTrace::clear(void) {
+  _lock();
+  _head = 0;
+  _count = 0;
+  _unlock();
+}
+
+/**
+ * Stop recording and release the ring buffer.
+ */
+void PageTrace::end(void) {
+  std::unique_ptr<_SpanST[]>  spans;
+  _lock();
+  _active = false;
+  _spans.swap(spans);
+  _capacity = 0;
+  _head = 0;
+  _count = 0;
+  _unlock();
+}
+
+/**
+ * Write the recorded spans in the Chrome trace-event format. Each span
+ * is copied out of the ring buffer at a time, so the recording is not
+ * blocked during the output.
+ * @param   out   Output destination.
+ * @return  Length of the output.
+ */
+size_t PageTrace::dump(Print& out) {
+  size_t  n = out.print(F("{\"traceEvents\":["));
+
+  for (size_t i = 0; ; i++) {
+    _SpanST span;
+    _lock();
+    const bool  valid = _spans && i < _count;
+    if (valid)
+      span = _spans[(_head + _capacity - _count + i) % _capacity];
+    _unlock();
+    if (!valid)
+      break;
+
+    String  event;
+    event.reserve(112 + PAGETRACE_ARG_LENGTH);
+    if (i)
+      event += ',';
+    event += F("{\"name\":\"");
+    event += FPSTR(span.name);
+    event += F("\",\"cat\":\"PageBuilder\",\"ph\":\"X\",\"pid\":1,\"tid\":");
+    event += String(span.tid);
+    event += F(",\"ts\":");
+    event += String(span.start);
+    event += F(",\"dur\":");
+    event += String(span.duration);
+    if (span.arg[0]) {
+      event += F(",\"args\":{\"arg\":\"");
+      PageEscape::escape(event, span.arg, strlen(span.arg), PageEscape::JSON);
+      event += F("\"}");
+    }
+    event += '}';
+    n += out.print(event);
+  }
+  n += out.print(F("],\"displayTimeUnit\":\"ms\"}"));
+  return n;
+}
+
+#if !defined(ARDUINO)
+/**
+ * Write the recorded spans into the file of the host.
+ * @param   path  Path of the file.
+ * @return  false   The file could not be written.
+ */
+bool PageTrace::dump(const char* path) {
+  FILE* file = fopen(path, "w");
+  if (!file)
+    return false;
+  _FilePrint  out(file);
+  dump(out);
+  return !fclose(file);
+}
+#endif
+
+/**
+ * Respond to the request with the recorded spans. It is intended to be
+ * the handler of the endpoint such as
+ * server.on("/trace", [&]() { PageTrace::send(server); }).
+ * @param   server  Reference of the WebServer instance.
+ */
+void PageTrace::send(WebServer& server) {
+  PageOutput  output(server);
+  if (!output.begin()) {
+    PB_DBG("Trace output unbuffered, free:%u\n", ESP.getFreeHeap());
+  }
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  _OutputPrint  out(output);
+  dump(out);
+  output.flush();
+  server.sendContent("");
+}
+
+/**
+ * Start the span. The ring buffer is not touched here, the recording
+ * checks it under the exclusion.
+ * @param   name  Name of the span in the PROGMEM.
+ * @param   arg   Argument of the span, it can be nullptr.
+ */
+PageTraceSpan::PageTraceSpan(PGM_P name, const char* arg) : _name(name) {
+  _arg[0] = '\0';
+  if (arg && PageTrace::active())
+    strncat(_arg, arg, sizeof(_arg) - 1);
+  _start = micros();
+}
+
+/**
+ * Record the span at the end of the scope.
+ */
+PageTraceSpan::~PageTraceSpan() {
+  if (PageTrace::active())
+    PageTrace::_record(_name, _arg, _start);
+}
+
+/**
+ * Record the completed span into the ring buffer. The oldest span is
+ * overwritten when the buffer is full.
+ * @param   name      Name of the span in the PROGMEM.
+ * @param   arg       Argument of the span.
+ * @param   start     Start time in microseconds.
+ */
+void PageTrace::_record(PGM_P name, const char* arg, const uint32_t start) {
+  const uint32_t  duration = micros() - start;
+  const uint32_t  tid = _threadId();
+
+  _lock();
+  if (_spans) {
+    _SpanST&  span = _spans[_head];
+    span.name = name;
+    memcpy(span.arg, arg, sizeof(span.arg));
+    span.start = start;
+    span.duration = duration;
+    span.tid = tid;
+    _head = (_head + 1) % _capacity;
+    if (_count < _capacity)
+      _count++;
+  }
+  _unlock();
+}
+
+/**
+ * Exclude the workers that record the spans concurrently.
+ */
+void PageTrace::_lock(void) {
+#if defined(ARDUINO_ARCH_ESP32)
+  portENTER_CRITICAL(&_mux);
+#elif !defined(ARDUINO)
+  _mutex.lock();
+#endif
+}
+
+/**
+ * Release the exclusion.
+ */
+void PageTrace::_unlock(void) {
+#if defined(ARDUINO_ARCH_ESP32)
+  portEXIT_CRITICAL(&_mux);
+#elif !defined(ARDUINO)
+  _mutex.unlock();
+#endif
+}
@@ -0,0 +1,117 @@
+/**
+ *  Declaration of PageTrace class.
+ *  @file PageTrace.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGETRACE_H_
+#define _PAGETRACE_H_
+
+#include <memory>
+#if !defined(ARDUINO_ARCH_ESP8266)
+#include <atomic>
+#endif
+#include "PageBuilder.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif !defined(ARDUINO)
+#include <mutex>
+#endif
+
+// Number of the spans that the ring buffer holds. The oldest span is
+// overwritten when the buffer is full.
+#ifndef PAGETRACE_CAPACITY
+#define PAGETRACE_CAPACITY                128
+#endif
+
+// The argument of the span such as the token name is truncated to this
+// length.
+#ifndef PAGETRACE_ARG_LENGTH
+#define PAGETRACE_ARG_LENGTH              16
+#endif
+
+// The spans are instrumented only if PB_TRACE is defined, and they are
+// recorded after PageTrace::begin. The argument is not evaluated unless
+// the recording is active.
+#ifdef PB_TRACE
+#define PB_TRACE_CONCAT_(a, b)            a##b
+#define PB_TRACE_CONCAT(a, b)             PB_TRACE_CONCAT_(a, b)
+#define PB_TRACE_SPAN(name, arg)          PageTraceSpan PB_TRACE_CONCAT(_pbTraceSpan, __LINE__)(PSTR(name), PageTrace::active() ? PageTraceSpan::argument(arg) : nullptr)
+#else
+#define PB_TRACE_SPAN(name, arg)          do {} while (0)
+#endif
+
+/**
+ * Render tracing into a ring buffer of the spans. The spans are
+ * instrumented around the request handling, the token handlers and the
+ * transmissions, and they are dumped in the Chrome trace-event format
+ * that the trace viewers such as chrome://tracing or Perfetto load.
+ */
+class PageTrace {
+  friend class PageTraceSpan;
+
+ public:
+  static bool   active(void) { return _active; }
+  static bool   begin(const size_t capacity = PAGETRACE_CAPACITY);
+  static void   clear(void);
+  static size_t dump(Print& out);
+#if !defined(ARDUINO)
+  static bool   dump(const char* path);
+#endif
+  static void   end(void);
+  static void   send(WebServer& server);
+
+ protected:
+  // A completed span.
+  typedef struct {
+    PGM_P     name;                   /**< Name of the span in the PROGMEM */
+    char      arg[PAGETRACE_ARG_LENGTH];  /**< Argument of the span */
+    uint32_t  start;                  /**< Start time in microseconds */
+    uint32_t  duration;               /**< Duration in microseconds */
+    uint32_t  tid;                    /**< Thread on which the span ran */
+  } _SpanST;
+
+  static void   _lock(void);
+  static void   _record(PGM_P name, const char* arg, const uint32_t start);
+  static void   _unlock(void);
+
+#if defined(ARDUINO_ARCH_ESP8266)
+  // The WebServer of ESP8266 handles the requests only in the loop.
+  static bool _active;                /**< The spans are being recorded */
+#else
+  static std::atomic<bool>  _active;  /**< The spans are being recorded */
+#endif
+  static std::unique_ptr<_SpanST[]> _spans; /**< Ring buffer */
+  static size_t _capacity;            /**< Capacity of the ring buffer */
+  static size_t _head;                /**< Index of the next span */
+  static size_t _count;               /**< Number of the spans held */
+#if defined(ARDUINO_ARCH_ESP32)
+  static portMUX_TYPE _mux;           /**< Exclusion of the workers */
+#elif !defined(ARDUINO)
+  static std::mutex   _mutex;         /**< Exclusion of the threads */
+#endif
+};
+
+/**
+ * A span that is recorded at the end of the scope. The argument is
+ * copied at the construction.
+ */
+class PageTraceSpan {
+ public:
+  PageTraceSpan(PGM_P name, const char* arg = nullptr);
+  PageTraceSpan(PGM_P name, const String& arg) : PageTraceSpan(name, arg.c_str()) {}
+  ~PageTraceSpan();
+  static const char*  argument(const char* arg) { return arg; }
+  static const char*  argument(const String& arg) { return arg.c_str(); }
+
+ private:
+  PGM_P     _name;                    /**< Name of the span */
+  char      _arg[PAGETRACE_ARG_LENGTH];   /**< Argument of the span */
+  uint32_t  _start;                   /**< Start time in microseconds */
+};
+
+#endif // !_PAGETRACE_H_
@@ -0,0 +1,307 @@
+/**
+ *  An implementation of the upload sink of PageUploader class.
+ *  @file PageUploader.cpp
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#include "PageUploader.h"
+
+namespace {
+  // CRC-32 (IEEE 802.3) table for each nibble
+  const uint32_t  _crcTable[16] = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+  };
+
+  uint32_t _crc32(uint32_t crc, const uint8_t* data, size_t length) {
+    while (length--) {
+      crc ^= *data++;
+      crc = (crc >> 4) ^ _crcTable[crc & 0x0f];
+      crc = (crc >> 4) ^ _crcTable[crc & 0x0f];
+    }
+    return crc;
+  }
+}
+
+/**
+ * Construct the upload sink.
+ * @param   dir       Directory to store the uploaded file.
+ * @param   limit     Maximum file size, 0 is unlimited.
+ * @param   blockSize Size of the block written to the flash at once.
+ */
+PageUploader::PageUploader(const char* dir, const size_t limit, const size_t blockSize)
+: _dir(String(dir))
+, _limit(limit)
+, _blockSize(blockSize)
+, _buffer{ nullptr, nullptr }
+, _active(0)
+, _len(0)
+, _size(0)
+, _crc(0xffffffffUL)
+, _start(0)
+, _elapsed(0)
+, _status(Idle)
+#ifdef PB_UPLOADER_WRITERTASK
+, _requests(nullptr)
+, _freeBlocks(nullptr)
+, _done(nullptr)
+, _writerTask(nullptr)
+#endif
+{
+  if (!_dir.endsWith("/"))
+    _dir += '/';
+}
+
+/**
+ * The upload in progress is aborted with the destruction.
+ */
+PageUploader::~PageUploader() {
+  if (_buffer[0])
+    _end(Aborted);
+}
+
+/**
+ * Attach the uploader to the page as its upload handler.
+ * @param   page  PageBuilder to accept the upload.
+ */
+void PageUploader::attach(PageBuilder& page) {
+  page.onUpload([this](const String& uri, const HTTPUpload& upload) {
+    this->upload(uri, upload);
+  });
+}
+
+/**
+ * The upload handler. It can be called from the upload handler of the
+ * sketch as well.
+ * @param   uri     Requested uploading URI.
+ * @param   upload  The uploader of the WebServer.
+ */
+void PageUploader::upload(const String& uri, const HTTPUpload& upload) {
+  (void)(uri);
+  switch (upload.status) {
+  case UPLOAD_FILE_START:
+    if (_buffer[0])
+      _end(Aborted);
+    _begin(upload);
+    break;
+  case UPLOAD_FILE_WRITE:
+    if (_status == Receiving)
+      _receive(upload.buf, upload.currentSize);
+    break;
+  case UPLOAD_FILE_END:
+    if (_buffer[0])
+      _end(Completed);
+    break;
+  case UPLOAD_FILE_ABORTED:
+    if (_buffer[0])
+      _end(Aborted);
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+ * Start the upload, opens the file and allocates the block buffers.
+ * @param   upload  The uploader at the UPLOAD_FILE_START.
+ * @return  true  Ready to receive.
+ */
+bool PageUploader::_begin(const HTTPUpload& upload) {
+  // The path components of the client file name are discarded.
+  String  fileName = upload.filename;
+  int pos = std::max(fileName.lastIndexOf('/'), fileName.lastIndexOf('\\'));
+  if (pos >= 0)
+    fileName = fileName.substring(pos + 1);
+  _path = _dir + fileName;
+  _active = 0;
+  _len = 0;
+  _size = 0;
+  _crc = 0xffffffffUL;
+  _elapsed = 0;
+  _start = millis();
+
+  // The second buffer is used only while the writer task writes the
+  // first, otherwise the block is written in place.
+  _buffer[0] = reinterpret_cast<char*>(malloc(_blockSize));
+#ifdef PB_UPLOADER_WRITERTASK
+  _buffer[1] = reinterpret_cast<char*>(malloc(_blockSize));
+  if (!_buffer[0] || !_buffer[1]) {
+#else
+  if (!_buffer[0]) {
+#endif
+    PB_DBG("Upload buffer allocation failed, free:%u\n", ESP.getFreeHeap());
+    _release();
+    _status = NoMemory;
+    return false;
+  }
+
+  _file = PageBuilderFS::flash.open(_path, "w");
+  if (!_file) {
+    PB_DBG("Upload %s open failed\n", _path.c_str());
+    _release();
+    _status = OpenError;
+    return false;
+  }
+
+#ifdef PB_UPLOADER_WRITERTASK
+  _requests = xQueueCreate(2, sizeof(_WriteRequestST));
+  _freeBlocks = xSemaphoreCreateCounting(2, 1);
+  _done = xSemaphoreCreateBinary();
+  if (!_requests || !_freeBlocks || !_done
+    || xTaskCreate(_writer, "PageUploader", PAGEUPLOADER_WRITERTASK_STACK, this, uxTaskPriorityGet(nullptr), &_writerTask) != pdPASS) {
+    PB_DBG("Upload writer creation failed\n");
+    _writerTask = nullptr;
+    _file.close();
+    PageBuilderFS::flash.remove(_path);
+    _release();
+    _status = NoMemory;
+    return false;
+  }
+#endif
+
+  PB_DBG("Upload %s started\n", _path.c_str());
+  _status = Receiving;
+  return true;
+}
+
+/**
+ * End the upload. The remaining data is written if it completed, and
+ * the incomplete file is removed.
+ * @param   status  Status of the ending.
+ */
+void PageUploader::_end(const Status_t status) {
+  if (status == Completed && _status == Receiving && _len)
+    _submit();
+
+#ifdef PB_UPLOADER_WRITERTASK
+  if (_writerTask) {
+    const _WriteRequestST terminate = { nullptr, 0 };
+    xQueueSend(_requests, &terminate, portMAX_DELAY);
+    xSemaphoreTake(_done, portMAX_DELAY);
+    _writerTask = nullptr;
+  }
+#endif
+
+  // The error detected while receiving precedes the ending status.
+  if (_status == Receiving)
+    _status = status;
+  if (_file)
+    _file.close();
+  if (_status != Completed)
+    PageBuilderFS::flash.remove(_path);
+  _elapsed = millis() - _start;
+  _release();
+  PB_DBG("Upload %s %s, %u bytes %lu ms, crc:%08x\n", _path.c_str(), _status == Completed ? "completed" : "failed", _size, _elapsed, checksum());
+}
+
+/**
+ * Receive the uploaded data into the active buffer, and submits the
+ * buffer to write when it is filled.
+ * @param   data    The uploaded data.
+ * @param   length  Length of the data.
+ */
+void PageUploader::_receive(const uint8_t* data, size_t length) {
+  if (_limit && _size + length > _limit) {
+    PB_DBG("Upload exceeds %u bytes\n", _limit);
+    _end(Oversize);
+    return;
+  }
+  _crc = _crc32(_crc, data, length);
+  _size += length;
+
+  while (length) {
+    const size_t  n = std::min(_blockSize - _len, length);
+    memcpy(_buffer[_active] + _len, data, n);
+    _len += n;
+    data += n;
+    length -= n;
+    if (_len == _blockSize) {
+      if (!_submit()) {
+        _end(WriteError);
+        return;
+      }
+    }
+  }
+}
+
+/**
+ * Free the block buffers and the synchronization objects.
+ */
+void PageUploader::_release(void) {
+  for (char*& buffer : _buffer) {
+    free(buffer);
+    buffer = nullptr;
+  }
+#ifdef PB_UPLOADER_WRITERTASK
+  if (_requests)
+    vQueueDelete(_requests);
+  if (_freeBlocks)
+    vSemaphoreDelete(_freeBlocks);
+  if (_done)
+    vSemaphoreDelete(_done);
+  _requests = nullptr;
+  _freeBlocks = _done = nullptr;
+#endif
+}
+
+/**
+ * Submit the active buffer to write. With the writer task, receiving
+ * continues with the other buffer while the submitted buffer is being
+ * written. Without it, the single buffer is written and reused.
+ * @return  false if writing failed.
+ */
+bool PageUploader::_submit(void) {
+#ifdef PB_UPLOADER_WRITERTASK
+  const _WriteRequestST request = { _buffer[_active], _len };
+  xQueueSend(_requests, &request, portMAX_DELAY);
+  // Wait until the other buffer has been written.
+  xSemaphoreTake(_freeBlocks, portMAX_DELAY);
+  _active ^= 1;
+#else
+  _write(_buffer[_active], _len);
+#endif
+  _len = 0;
+  return _status == Receiving;
+}
+
+/**
+ * Write the block to the file.
+ * @param   block   The block.
+ * @param   length  Length of the block.
+ * @return  false if writing failed.
+ */
+bool PageUploader::_write(const char* block, const size_t length) {
+  if (_file.write(reinterpret_cast<const uint8_t*>(block), length) != length) {
+    PB_DBG("Upload write failed at %u\n", _file.position());
+    _status = WriteError;
+    return false;
+  }
+  return true;
+}
+
+#ifdef PB_UPLOADER_WRITERTASK
+/**
+ * The writer task writes the submitted blocks in order, and releases
+ * each block after writing.
+ * @param   uploader  The PageUploader instance.
+ */
+void PageUploader::_writer(void* uploader) {
+  PageUploader* self = static_cast<PageUploader*>(uploader);
+  _WriteRequestST request;
+
+  while (xQueueReceive(self->_requests, &request, portMAX_DELAY) == pdTRUE) {
+    if (!request.block)
+      break;
+    if (self->_status == Receiving)
+      self->_write(request.block, request.length);
+    xSemaphoreGive(self->_freeBlocks);
+  }
+  xSemaphoreGive(self->_done);
+  vTaskDelete(nullptr);
+}
+#endif
@@ -0,0 +1,113 @@
+/**
+ *  Declaration of PageUploader class.
+ *  @file PageUploader.h
+ *  @author hieromon@gmail.com
+ *  @version  1.5.6
+ *  @date 2026-10-18
+ *  @copyright  MIT license.
+ */
+
+#ifndef _PAGEUPLOADER_H_
+#define _PAGEUPLOADER_H_
+
+#include "PageBuilder.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+
+// The uploaded data is written to the flash with the block of this
+// size, which should be a multiple of the flash page.
+#ifndef PAGEUPLOADER_BLOCK_SIZE
+#if defined(ARDUINO_ARCH_ESP32)
+#define PAGEUPLOADER_BLOCK_SIZE           4096
+#else
+#define PAGEUPLOADER_BLOCK_SIZE           2048
+#endif
+#endif
+
+// On ESP32, the blocks are written to the flash by a writer task that
+// runs concurrently with receiving the next block. Undefine it to write
+// the blocks in the upload handler.
+#if defined(ARDUINO_ARCH_ESP32) && !defined(PB_UPLOADER_NOTASK)
+#define PB_UPLOADER_WRITERTASK
+#ifndef PAGEUPLOADER_WRITERTASK_STACK
+#define PAGEUPLOADER_WRITERTASK_STACK     4096
+#endif
+#endif
+
+/**
+ * The upload sink that stores the uploaded file to the file system of
+ * PageBuilderFS::flash. The received data is accumulated into the
+ * block buffer and written with large blocks aligned to the file
+ * offset. The size limit is enforced, and the CRC-32 checksum and the
+ * throughput are obtained with the upload.
+ */
+class PageUploader {
+ public:
+  // Status of the upload
+  enum Status_t {
+    Idle,         /**< No upload */
+    Receiving,    /**< Receiving */
+    Completed,    /**< The file has been stored */
+    Oversize,     /**< The file exceeds the size limit */
+    NoMemory,     /**< The buffer could not be allocated */
+    OpenError,    /**< The file could not be opened */
+    WriteError,   /**< Writing to the file failed */
+    Aborted       /**< The upload has been aborted */
+  };
+
+  explicit PageUploader(const char* dir = "/", const size_t limit = 0, const size_t blockSize = PAGEUPLOADER_BLOCK_SIZE);
+  PageUploader(const PageUploader&) = delete;
+  PageUploader& operator=(const PageUploader&) = delete;
+  ~PageUploader();
+  void  attach(PageBuilder& page);
+  uint32_t  checksum(void) const { return ~_crc; }
+  unsigned long elapsed(void) const { return _elapsed; }
+  const String& path(void) const { return _path; }
+  size_t  size(void) const { return _size; }
+  Status_t  status(void) const { return _status; }
+  uint32_t  throughput(void) const { return _elapsed ? static_cast<uint32_t>(static_cast<uint64_t>(_size) * 1000 / _elapsed) : 0; }
+  void  upload(const String& uri, const HTTPUpload& upload);
+
+ protected:
+  bool  _begin(const HTTPUpload& upload);
+  void  _end(const Status_t status);
+  void  _receive(const uint8_t* data, size_t length);
+  void  _release(void);
+  bool  _submit(void);
+  bool  _write(const char* block, const size_t length);
+
+  String  _dir;                       /**< Directory to store the file */
+  size_t  _limit;                     /**< Maximum file size, 0 is unlimited */
+  size_t  _blockSize;                 /**< Write block size */
+
+ private:
+  File    _file;                      /**< Destination file */
+  String  _path;                      /**< Path of the destination file */
+  char*   _buffer[2];                 /**< Block buffers, the second is for the writer task */
+  uint8_t _active;                    /**< Index of the buffer being filled */
+  size_t  _len;                       /**< Length of the data in the active buffer */
+  size_t  _size;                      /**< Total size of the received data */
+  uint32_t  _crc;                     /**< Running CRC-32 */
+  unsigned long _start;               /**< Time when the upload started */
+  unsigned long _elapsed;             /**< Time taken for the upload */
+  volatile Status_t _status;          /**< Status of the upload */
+#ifdef PB_UPLOADER_WRITERTASK
+  typedef struct {
+    char*   block;                    /**< Block to be written, nullptr terminates the writer */
+    size_t  length;                   /**< Length of the block */
+  } _WriteRequestST;
+
+  static void _writer(void* uploader);  /**< Writer task */
+
+  QueueHandle_t     _requests;        /**< Write requests to the writer */
+  SemaphoreHandle_t _freeBlocks;      /**< Blocks that have been written */
+  SemaphoreHandle_t _done;            /**< The writer has terminated */
+  TaskHandle_t      _writerTask;      /**< Writer task handle */
+#endif
+};
+
+#endif // !_PAGEUPLOADER_H_
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""Compress the molds of PageBuilder into the PROGMEM arrays.
+
+The mold is compressed in the gzip format with the small sliding window
+that the decompression of PageElement can hold, and is written as the C
+header that defines the array in the PROGMEM. The array is given to the
+PageElement with its length, and the tokens in the mold are replaced
+while it is decompressed.
+
+    python3 tools/pbdeflate.py data/index.htm -o src
+
+    #include "index_htm.h"
+    PageElement elm(INDEX_HTM, sizeof(INDEX_HTM), {{"TOKEN", handler}});
+
+The window must not exceed PAGEINFLATE_WINDOW of the sketch, 1024 bytes
+by default, which is the --window 10.
+"""
+
+import argparse
+import os
+import re
+import sys
+import zlib
+
+WINDOW_MIN = 9
+WINDOW_MAX = 15
+WINDOW_DEFAULT = 10
+COLUMNS = 16
+
+
+def compress(mold, window):
+    """Compress the mold into the gzip with the window of 2^window bytes."""
+    # The lexer stops at the nul character.
+    mold = mold.split(b"\0", 1)[0]
+    z = zlib.compressobj(9, zlib.DEFLATED, 16 + window, 9)
+    return z.compress(mold) + z.flush(), len(mold)
+
+
+def identifier(path):
+    """Name of the array derived from the file name."""
+    name = re.sub(r"[^0-9A-Za-z]", "_", os.path.basename(path)).upper()
+    return "_" + name if name[0].isdigit() else name
+
+
+def header(name, source, compressed, size):
+    """Generate the C header that defines the array."""
+    guard = "_{}_H_".format(name)
+    lines = [
+        "// Generated by tools/pbdeflate.py from {}, {} -> {} bytes.".format(source, size, len(compressed)),
+        "#ifndef {}".format(guard),
+        "#define {}".format(guard),
+        "",
+        "#include <Arduino.h>",
+        "",
+        "const uint8_t {}[] PROGMEM = {{".format(name),
+    ]
+    for i in range(0, len(compressed), COLUMNS):
+        lines.append("  " + ", ".join("0x{:02x}".format(b) for b in compressed[i:i + COLUMNS]) + ",")
+    lines += ["};", "", "#endif // !{}".format(guard), ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress the molds of PageBuilder into the PROGMEM arrays.")
+    parser.add_argument("molds", nargs="+", help="mold files such as data/*.htm")
+    parser.add_argument("-o", "--outdir", help="output directory, the same as the mold by default")
+    parser.add_argument("-w", "--window", type=int, default=WINDOW_DEFAULT,
+                        help="base-2 logarithm of the window, {} by default".format(WINDOW_DEFAULT))
+    args = parser.parse_args()
+    if not WINDOW_MIN <= args.window <= WINDOW_MAX:
+        sys.stderr.write("window must be {} to {}\n".format(WINDOW_MIN, WINDOW_MAX))
+        return 1
+
+    for path in args.molds:
+        with open(path, "rb") as f:
+            mold = f.read()
+        compressed, size = compress(mold, args.window)
+        name = identifier(path)
+        outdir = args.outdir if args.outdir else os.path.dirname(path)
+        out = os.path.join(outdir, name.lower().lstrip("_") + ".h")
+        with open(out, "w") as f:
+            f.write(header(name, os.path.basename(path), compressed, size))
+        print("{} -> {}: {} -> {} bytes".format(path, out, size, len(compressed)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Precompile the file: molds of PageBuilder.
+
+The mold is parsed the same way as the PageElement lexer does, and is
+converted into the precompiled mold that consists of the segment table
+of the literals and the interned token names. The PageElement reads the
+precompiled mold in place of the file: mold when the file with the
+suffix .pbm exists alongside it.
+
+    python3 tools/pbmold.py data/*.htm
+
+Layout of the precompiled mold, all numbers are little-endian:
+
+    magic           4 bytes   "PBM" 0x01
+    token count     uint16
+    segment count   uint16
+    literal size    uint32    Total length of the literals
+    token table     token count x (uint8 length, name)
+    segment table   segment count x uint32
+                    The token segment has bit 31 set with the token id
+                    in the low 16 bits, otherwise it is the length of
+                    the literal which follows the previous one.
+    literals        literal size bytes
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"PBM\x01"
+SUFFIX = ".pbm"
+TOKEN = 0x80000000
+DELIMITER_OPEN = ord("{")
+DELIMITER_CLOSE = ord("}")
+# The token name is served within the block buffer of PageElement,
+# PAGEELEMENT_FILEBUFFER_SIZE - 4.
+TOKEN_MAX = 124
+
+
+def parse(mold):
+    """Split the mold into the literals and the tokens as the lexer does."""
+    # The lexer stops at the nul character.
+    mold = mold.split(b"\0", 1)[0]
+    segments = []
+    literal = bytearray()
+    pos = 0
+    while pos < len(mold):
+        found = mold.find(bytes((DELIMITER_OPEN, DELIMITER_OPEN)), pos)
+        if found < 0:
+            literal += mold[pos:]
+            break
+        literal += mold[pos:found]
+        pos = found + 2
+        token = bytearray()
+        while pos < len(mold):
+            c = mold[pos]
+            pos += 1
+            if c == DELIMITER_CLOSE:
+                if pos >= len(mold):
+                    break
+                sub = mold[pos]
+                pos += 1
+                if sub == DELIMITER_CLOSE:
+                    break
+                token += bytes((c, sub))
+            else:
+                token.append(c)
+        # An empty token is skipped by the lexer.
+        if token:
+            if literal:
+                segments.append(bytes(literal))
+                literal = bytearray()
+            segments.append(token.decode("latin-1"))
+    if literal:
+        segments.append(bytes(literal))
+    return segments
+
+
+def compile_mold(mold):
+    """Compile the mold into the precompiled mold."""
+    segments = parse(mold)
+    tokens = []
+    table = []
+    literals = bytearray()
+    for segment in segments:
+        if isinstance(segment, str):
+            if segment not in tokens:
+                if len(segment) > TOKEN_MAX:
+                    raise ValueError("token {{{{{}}}}} exceeds {} characters".format(segment, TOKEN_MAX))
+                tokens.append(segment)
+            table.append(TOKEN | tokens.index(segment))
+        else:
+            table.append(len(segment))
+            literals += segment
+    if len(tokens) > 0xffff or len(table) > 0xffff:
+        raise ValueError("too many tokens or segments")
+
+    out = bytearray(MAGIC)
+    out += struct.pack("<HHI", len(tokens), len(table), len(literals))
+    for token in tokens:
+        name = token.encode("latin-1")
+        out += struct.pack("<B", len(name)) + name
+    for segment in table:
+        out += struct.pack("<I", segment)
+    out += literals
+    return bytes(out), len(tokens), len(table), len(literals)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Precompile the file: molds of PageBuilder.")
+    parser.add_argument("molds", nargs="+", help="mold files such as data/*.htm")
+    parser.add_argument("-o", "--outdir", help="output directory, the same as the mold by default")
+    args = parser.parse_args()
+
+    for path in args.molds:
+        with open(path, "rb") as f:
+            mold = f.read()
+        try:
+            compiled, tokens, segments, size = compile_mold(mold)
+        except ValueError as e:
+            sys.stderr.write("{}: {}\n".format(path, e))
+            return 1
+        outdir = args.outdir if args.outdir else os.path.dirname(path)
+        out = os.path.join(outdir, os.path.basename(path) + SUFFIX)
+        with open(out, "wb") as f:
+            f.write(compiled)
+        print("{} -> {}: {} tokens, {} segments, {} literal bytes".format(path, out, tokens, segments, size))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())